@@ -473,6 +473,8 @@ bool ATADevice::ReadWriteSector(bool fWrite_)
     if (fWrite_)
         return WriteSector(uSector, m_sector_data.data());
 
+    // Tell the device how many sectors remain in the command, so it can read ahead
+    ReadAhead(uSector, m_sRegs.bSectorCount ? m_sRegs.bSectorCount : 256);
     return ReadSector(uSector, m_sector_data.data());
 }
 
@@ -119,6 +119,7 @@ public:
 public:
     virtual bool ReadSector(unsigned int uSector_, uint8_t* pb_) = 0;
     virtual bool WriteSector(unsigned int uSector_, uint8_t* pb_) = 0;
+    virtual void ReadAhead(unsigned int /*uSector_*/, unsigned int /*uCount_*/) { }   // hint for sequential reads
 
 protected:
     bool ReadWriteSector(bool fWrite_);
@@ -180,7 +180,7 @@ static bool WriteVideoHeader(FILE* file)
 
 static bool WriteAudioHeader(FILE* file)
 {
-    uint16_t wFreq = SAMPLE_FREQ;
+    uint32_t dwFreq = Sound::SampleFreq();
     uint16_t wBits = SAMPLE_BITS;
     uint16_t wBlock = BYTES_PER_SAMPLE;
     uint16_t wChannels = SAMPLE_CHANNELS;
@@ -191,7 +191,7 @@ static bool WriteAudioHeader(FILE* file)
     WriteLittleEndianDWORD(0);              // priority and language, unused
     WriteLittleEndianDWORD(1);              // initial frames
     WriteLittleEndianDWORD(wBlock);         // scale
-    WriteLittleEndianDWORD(wFreq * wBlock); // rate
+    WriteLittleEndianDWORD(dwFreq * wBlock); // rate
     WriteLittleEndianDWORD(0);              // start time
     WriteLittleEndianDWORD(num_audio_samples); // total samples in stream
     WriteLittleEndianLong(max_audio_size);  // suggested buffer size
@@ -204,8 +204,8 @@ static bool WriteAudioHeader(FILE* file)
     pos = WriteChunkStart(file, "strf");
     WriteLittleEndianWORD(1);               // format tag (1 = WAVE_FORMAT_PCM)
     WriteLittleEndianWORD(wChannels);       // channels
-    WriteLittleEndianDWORD(wFreq);          // samples per second
-    WriteLittleEndianDWORD(wFreq * wBlock); // average bytes per second
+    WriteLittleEndianDWORD(dwFreq);         // samples per second
+    WriteLittleEndianDWORD(dwFreq * wBlock); // average bytes per second
     WriteLittleEndianWORD(wBlock);          // block align
     WriteLittleEndianWORD(wBits);           // bits per sample
     WriteLittleEndianWORD(0);               // extra structure size
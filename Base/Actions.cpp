@@ -21,6 +21,7 @@
 #include "SimCoupe.h"
 #include "Actions.h"
 
+#include "AtaAdapter.h"
 #include "AVI.h"
 #include "CPU.h"
 #include "Debug.h"
@@ -68,6 +69,8 @@ static const std::vector<ActionEntry> actions =
     { Action::NewDisk2, "NewDisk2", "New disk 2" },
     { Action::InsertDisk2, "InsertDisk2", "Insert disk 2" },
     { Action::EjectDisk2, "EjectDisk2", "Close disk 2" },
+    { Action::CommitOverlay, "CommitOverlay", "Commit disk overlay changes" },
+    { Action::DiscardOverlay, "DiscardOverlay", "Discard disk overlay changes" },
     { Action::InsertTape, "InsertTape", "Insert Tape" },
     { Action::EjectTape, "EjectTape", "Eject Tape" },
     { Action::TapeBrowser, "TapeBrowser", "Tape Browser" },
@@ -186,6 +189,31 @@ bool Do(Action action, bool pressed/*=true*/)
             }
             break;
 
+        case Action::CommitOverlay:
+        case Action::DiscardOverlay:
+        {
+            if (!GetOption(diskoverlay))
+            {
+                Frame::SetStatus("Disk overlay is not enabled");
+                break;
+            }
+
+            auto commit = action == Action::CommitOverlay;
+            bool ok = true;
+
+            for (auto drive : { pFloppy1.get(), pFloppy2.get() })
+                ok &= commit ? drive->CommitOverlay() : drive->DiscardOverlay();
+
+            for (auto adapter : { pAtom.get(), pAtomLiteLeft.get(), pAtomLite.get(), pSDIDE.get() })
+                ok &= commit ? adapter->CommitOverlay() : adapter->DiscardOverlay();
+
+            if (!ok)
+                Message(MsgType::Warning, "Failed to {} disk overlay changes", commit ? "commit" : "discard");
+            else
+                Frame::SetStatus("Disk overlay changes {}", commit ? "committed" : "discarded");
+            break;
+        }
+
         case Action::NewDisk1:
             GUI::Start(new NewDiskDialog(1));
             break;
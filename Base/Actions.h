@@ -25,6 +25,7 @@ enum class Action
     None,
     NewDisk1, InsertDisk1, EjectDisk1,
     NewDisk2, InsertDisk2, EjectDisk2,
+    CommitOverlay, DiscardOverlay,
     InsertTape, EjectTape, TapeBrowser,
     Paste, ImportData, ExportData, ExportCometSymbols, SavePNG, SaveSSX,
     TogglePrinter, FlushPrinter,
@@ -94,3 +94,19 @@ void AtaAdapter::Detach()
     m_pDisk0.reset();
     m_pDisk1.reset();
 }
+
+bool AtaAdapter::CommitOverlay()
+{
+    bool ret = true;
+    if (m_pDisk0) ret &= m_pDisk0->CommitOverlay();
+    if (m_pDisk1) ret &= m_pDisk1->CommitOverlay();
+    return ret;
+}
+
+bool AtaAdapter::DiscardOverlay()
+{
+    bool ret = true;
+    if (m_pDisk0) ret &= m_pDisk0->DiscardOverlay();
+    if (m_pDisk1) ret &= m_pDisk1->DiscardOverlay();
+    return ret;
+}
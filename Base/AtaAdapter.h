@@ -39,6 +39,9 @@ public:
     virtual bool Attach(std::unique_ptr<HardDisk> disk, int nDevice_);
     virtual void Detach();
 
+    bool CommitOverlay();
+    bool DiscardOverlay();
+
 protected:
     uint16_t InWord(uint16_t wPort_);
     void OutWord(uint16_t wPort_, uint16_t wVal_);
@@ -106,3 +106,127 @@ bool AtomLiteDevice::Attach(std::unique_ptr<HardDisk> disk, int nDevice_)
 
     return AtaAdapter::Attach(std::move(disk), nDevice_);
 }
+
+////////////////////////////////////////////////////////////////////////////////
+
+// HDF access as it was before positional I/O and the sector cache, with a seek
+// and read for each sector, used as the benchmark baseline
+class StdioHardDisk final : public HardDisk
+{
+public:
+    StdioHardDisk(const std::string& disk_path) : HardDisk(disk_path) { }
+
+    bool Open(bool /*read_only*/) override
+    {
+        std::array<uint8_t, 11> header;
+        m_file = fopen(m_strPath.c_str(), "rb");
+        if (!m_file || fread(header.data(), 1, header.size(), m_file) != header.size() ||
+            memcmp(header.data(), "RS-IDE", 6) || fseek(m_file, 0, SEEK_END))
+        {
+            return false;
+        }
+
+        // Data offset from the HDF header, with the sector count from the file size
+        m_data_offset = (header[10] << 8) | header[9];
+        m_sGeometry.uTotalSectors = static_cast<unsigned int>((ftell(m_file) - m_data_offset) / 512);
+        SetIdentifyData(nullptr);
+        return true;
+    }
+
+    bool ReadSector(unsigned int uSector_, uint8_t* pb_) override
+    {
+        return fseek(m_file, static_cast<long>(m_data_offset + uSector_ * 512L), SEEK_SET) == 0 &&
+            fread(pb_, 1, 512, m_file) == 512;
+    }
+
+    bool WriteSector(unsigned int, uint8_t*) override { return false; }
+
+protected:
+    unique_FILE m_file;
+    long m_data_offset = 0;
+};
+
+// Sequential read throughput through the Atom Lite ports, using the register
+// accesses BDOS makes: 8-bit transfers, an LBA command per request and a
+// status poll before each sector's data. Each access method is measured with
+// single sector reads and multi-sector reads, which allow read-ahead.
+std::string AtomLiteDevice::Benchmark(const std::string& disk_path)
+{
+    constexpr uint8_t ata_regs = ATA_CS1;           // command block registers (CS0 active)
+    constexpr unsigned int bench_sectors = 64 * 1024 * 1024 / 512;
+
+    static constexpr std::array<std::pair<const char*, uint8_t>, 2> commands{ {
+        { "read sectors x1", 1 }, { "read multiple x16", 16 } } };
+
+    using OpenFn = std::function<std::unique_ptr<HardDisk>()>;
+    std::array<std::pair<const char*, OpenFn>, 3> methods{ {
+        { "stdio (baseline)", [&] {
+            auto disk = std::make_unique<StdioHardDisk>(disk_path);
+            return disk->Open(true) ? std::unique_ptr<HardDisk>(std::move(disk)) : nullptr; } },
+        { "mapped read-only", [&] { return HardDisk::OpenObject(disk_path, true); } },
+        { "cached writable", [&] { return HardDisk::OpenObject(disk_path, false); } } } };
+
+    auto report = fmt::format("Atom Lite benchmark: {}\n", disk_path);
+
+    // Read the benchmark area once first, so every method runs from a warm OS file cache
+    if (auto mapped = MappedFile::Open(disk_path))
+    {
+        auto data = mapped->Data();
+        data = data.subspan(0, std::min<size_t>(data.size(), bench_sectors * 512 + 0x10000));
+        report += fmt::format("  warm-up checksum {:08x}\n", std::accumulate(data.begin(), data.end(), 0U));
+    }
+
+    for (auto& [method, open_disk] : methods)
+    {
+        for (auto& [name, count] : commands)
+        {
+            auto disk = open_disk();
+            if (!disk)
+                return fmt::format("Failed to open hard disk image:\n\n{}", disk_path);
+
+            auto total_sectors = std::min(disk->GetGeometry()->uTotalSectors, bench_sectors);
+            AtomLiteDevice atom;
+            if (!atom.Attach(std::move(disk), 0))
+                return fmt::format("Not an Atom Lite disk:\n\n{}", disk_path);
+
+            auto write_reg = [&](uint8_t reg, uint8_t val) { atom.Out(5, ata_regs | reg); atom.Out(6, val); };
+            auto read_reg = [&](uint8_t reg) { atom.Out(5, ata_regs | reg); return atom.In(6); };
+
+            // Enable 8-bit data transfers, as BDOS does
+            write_reg(1, 0x01);
+            write_reg(7, 0xef);
+
+            uint32_t checksum = 0;
+            auto cmd = (count > 1) ? 0xc4 : 0x20;
+
+            auto start_time = std::chrono::high_resolution_clock::now();
+
+            for (unsigned int sector = 0; sector + count <= total_sectors; sector += count)
+            {
+                write_reg(6, static_cast<uint8_t>(0xe0 | ((sector >> 24) & 0x0f)));
+                write_reg(2, count);
+                write_reg(3, static_cast<uint8_t>(sector));
+                write_reg(4, static_cast<uint8_t>(sector >> 8));
+                write_reg(5, static_cast<uint8_t>(sector >> 16));
+                write_reg(7, static_cast<uint8_t>(cmd));
+
+                for (int i = 0; i < count; ++i)
+                {
+                    if (!(read_reg(7) & ATA_STATUS_DRQ))
+                        return fmt::format("Read failed at sector {}:\n\n{}", sector + i, disk_path);
+
+                    atom.Out(5, ata_regs);
+                    for (int j = 0; j < 512; ++j)
+                        checksum += atom.In(6);
+                }
+            }
+
+            auto elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+            auto megabytes = total_sectors * 512.0 / (1024 * 1024);
+            report += fmt::format("  {:<17} {:<18} {:.0f}MB in {:.2f}s, {:.1f}MB/s (checksum {:08x})\n",
+                method, name, megabytes, elapsed, megabytes / elapsed, checksum);
+        }
+    }
+
+    return report;
+}
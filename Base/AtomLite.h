@@ -35,6 +35,8 @@ public:
 public:
     bool Attach(std::unique_ptr<HardDisk> disk, int nDevice_) override;
 
+    static std::string Benchmark(const std::string& disk_path);
+
 protected:
     DallasClock m_Dallas{};
     uint8_t m_bAddressLatch = 0;
@@ -209,6 +209,30 @@ private:
     Blip_Synth_ impl;
 };
 
+// Cheaper alternative to Blip_Synth, splitting each step between the two samples
+// either side of the kernel centre by its phase. The output latency matches
+// Blip_Synth, but the output isn't band-limited and there's no treble control.
+template<int range>
+class Blip_Linear_Synth {
+public:
+    void volume(double v);
+
+    Blip_Buffer* output() const { return buf; }
+    void output(Blip_Buffer* b) { buf = b; }
+
+    void offset_resampled(blip_resampled_time_t, int delta, Blip_Buffer*) const;
+    void offset_inline(blip_time_t t, int delta, Blip_Buffer* buf) const {
+        offset_resampled(t * buf->factor_ + buf->offset_, delta, buf);
+    }
+    void offset_inline(blip_time_t t, int delta) const {
+        offset_resampled(t * buf->factor_ + buf->offset_, delta, buf);
+    }
+
+private:
+    Blip_Buffer* buf = nullptr;
+    blip_long delta_factor = 0;
+};
+
 // Low-pass equalization parameters
 class blip_eq_t {
 public:
@@ -402,6 +426,27 @@ void Blip_Synth<quality, range>::update(blip_time_t t, int amp)
     offset_resampled(t * impl.buf->factor_ + impl.buf->offset_, delta, impl.buf);
 }
 
+template<int range>
+void Blip_Linear_Synth<range>::volume(double v)
+{
+    // Unit step in the buffer's internal sample resolution
+    delta_factor = (blip_long)(v / (range < 0 ? -range : range) * (1L << blip_sample_bits));
+}
+
+template<int range>
+void Blip_Linear_Synth<range>::offset_resampled(blip_resampled_time_t time,
+    int delta, Blip_Buffer* blip_buf) const
+{
+    assert((blip_long)(time >> BLIP_BUFFER_ACCURACY) < blip_buf->buffer_size_);
+    blip_long* buf = blip_buf->buffer_ + (time >> BLIP_BUFFER_ACCURACY) + blip_widest_impulse_ / 2 - 1;
+    int phase = (int)(time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) & (blip_res - 1));
+
+    blip_long step = delta * delta_factor;
+    blip_long right = (step >> BLIP_PHASE_BITS) * phase;
+    buf[0] += step - right;
+    buf[1] += right;
+}
+
 inline blip_eq_t::blip_eq_t(double t) :
     treble(t), rolloff_freq(0), sample_rate(44100), cutoff_freq(0) { }
 inline blip_eq_t::blip_eq_t(double t, long rf, long sr, long cf) :
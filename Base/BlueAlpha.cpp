@@ -30,12 +30,16 @@
 //
 // Note: This module supports only a subset of the 8255 PPI chip, as used
 // for normal sampler operation.  Use outside that mode is currently undefined.
+//
+// The PortC clock bit toggles every half period while the DAC or ADC is
+// enabled. Rather than scheduling an event for every toggle, the bit is
+// calculated from the clock start time when it's needed. Disabling the
+// clock freezes it after the next toggle, as the hardware would.
 
 #include "SimCoupe.h"
 #include "BlueAlpha.h"
 
 #include "CPU.h"
-#include "Events.h"
 #include "Options.h"
 #include "Sound.h"
 
@@ -55,20 +59,32 @@ void BASamplerDevice::Reset()
     m_bPortB = 0xff;    // no active features
     m_bPortC = 0x00;    // no clock
     m_bControl = BLUEALPHA_SIGNATURE;  // control
+    m_clock_running = false;
 }
 
-void BASamplerDevice::Clock(uint32_t event_time)
+void BASamplerDevice::FrameEnd()
 {
-    // Toggle clock bit every half period
-    m_bPortC ^= PORTA_CLOCK;
-
-    // If DAC or ADC are enabled, return true to keep the clock running
-    if ((~m_bPortB & (PORTB_DAC_ENABLE | PORTB_ADC_ENABLE)) != 0)
+    // Keep the clock times relative to the start of the frame
+    if (m_clock_running)
     {
-        AddEvent(EventType::BlueAlphaClock, event_time + m_cpuCyclesPerClock);
+        m_clock_start -= CPU_CYCLES_PER_FRAME;
+        m_clock_stop -= CPU_CYCLES_PER_FRAME;
     }
 }
 
+void BASamplerDevice::UpdateClock()
+{
+    if (!m_clock_running)
+        return;
+
+    auto now = std::min(static_cast<int64_t>(CPU::frame_cycles), m_clock_stop);
+    auto toggles = (now - m_clock_start) / m_cpuCyclesPerClock;
+    m_bPortC = (m_bPortC & ~PORTA_CLOCK) | ((m_clock_phase ^ toggles) & PORTA_CLOCK);
+
+    if (now == m_clock_stop)
+        m_clock_running = false;
+}
+
 uint8_t BASamplerDevice::In(uint16_t wPort_)
 {
     switch (wPort_ & 3)
@@ -82,6 +98,7 @@ uint8_t BASamplerDevice::In(uint16_t wPort_)
         return m_bPortA;
 
     case 2:
+        UpdateClock();
         return m_bPortC;
     }
 
@@ -102,24 +119,50 @@ void BASamplerDevice::Out(uint16_t wPort_, uint8_t bVal_)
         break;
 
     case 1:
+        UpdateClock();
+
         // If DAC/ADC were disabled but one is now enabled, start the clock
         if (!(~m_bPortB & (PORTB_DAC_ENABLE | PORTB_ADC_ENABLE)) &&
             (~bVal_ & (PORTB_DAC_ENABLE | PORTB_ADC_ENABLE)))
         {
             auto freq = std::min(std::max(8000, GetOption(samplerfreq)), 48000);
             m_cpuCyclesPerClock = CPU_CLOCK_HZ / freq / 2;
-            AddEvent(EventType::BlueAlphaClock, CPU::frame_cycles + m_cpuCyclesPerClock);
+
+            if (!m_clock_running)
+            {
+                m_clock_running = true;
+                m_clock_start = CPU::frame_cycles;
+                m_clock_phase = m_bPortC & PORTA_CLOCK;
+            }
+
+            m_clock_stop = INT64_MAX;
+        }
+        // If both are now disabled, the clock stops after the next toggle
+        else if (m_clock_running && !(~bVal_ & (PORTB_DAC_ENABLE | PORTB_ADC_ENABLE)))
+        {
+            auto toggles = (CPU::frame_cycles - m_clock_start) / m_cpuCyclesPerClock;
+            m_clock_stop = m_clock_start + (toggles + 1) * m_cpuCyclesPerClock;
         }
 
         m_bPortB = bVal_;
         break;
 
     case 3:
+        UpdateClock();
         m_bControl = bVal_;
 
         // If mode 2 is set, set the handshaking lines to show we're ready
         if ((bVal_ & 0xc0) == 0xc0)
+        {
             m_bPortC = 0xa0;
+
+            // Re-base the clock phase so toggles continue from the new value
+            if (m_clock_running)
+            {
+                auto toggles = (CPU::frame_cycles - m_clock_start) / m_cpuCyclesPerClock;
+                m_clock_phase = (m_bPortC ^ toggles) & PORTA_CLOCK;
+            }
+        }
         break;
     }
 }
@@ -33,9 +33,10 @@ public:
     void Reset() override;
     uint8_t In(uint16_t wPort_) override;
     void Out(uint16_t wPort_, uint8_t bVal_) override;
+    void FrameEnd() override;
 
-public:
-    void Clock(uint32_t event_time);
+protected:
+    void UpdateClock();
 
 protected:
     uint8_t m_bControl = 0;
@@ -43,6 +44,11 @@ protected:
     uint8_t m_bPortB = 0;
     uint8_t m_bPortC = 0;
     int m_cpuCyclesPerClock{};
+
+    bool m_clock_running = false;
+    int64_t m_clock_start = 0;      // clock start time, relative to the current frame
+    int64_t m_clock_stop = 0;       // time of the final toggle after the clock is disabled
+    uint8_t m_clock_phase = 0;      // clock bit value at the start time
 };
 
 extern std::unique_ptr<BASamplerDevice> pSampler;
@@ -81,6 +81,7 @@ bool Init(bool fFirstInit_/*=false*/)
         InitEvents();
         AddEvent(EventType::FrameInterrupt, 0);
         AddEvent(EventType::InputUpdate, CPU_CYCLES_PER_FRAME * 3 / 4);
+        AddEvent(EventType::SoundUpdate, CPU_CYCLES_PER_FRAME / 4);
 
         cpu.on_reset(false);
         fRet &= Memory::Init(true) && IO::Init();
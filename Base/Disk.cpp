@@ -22,6 +22,179 @@
 #include "Disk.h"
 
 #include "Drive.h"
+#include "Options.h"
+
+#ifdef _WIN32
+#include <io.h>
+#endif
+
+// Positional write, leaving the file position untouched
+static bool WriteFileData(FILE* file, uint64_t offset, const uint8_t* pb_, size_t len)
+{
+    if (!file)
+        return false;
+
+#ifdef _WIN32
+    OVERLAPPED ov{};
+    ov.Offset = static_cast<DWORD>(offset);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    DWORD dwWritten = 0;
+    auto hfile = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)));
+    return WriteFile(hfile, pb_, static_cast<DWORD>(len), &dwWritten, &ov) && dwWritten == len;
+#else
+    return pwrite(fileno(file), pb_, len, static_cast<off_t>(offset)) == static_cast<ssize_t>(len);
+#endif
+}
+
+static bool SyncFile(FILE* file)
+{
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Modified image data is written by a background thread, so saves don't block
+// emulation. Jobs run in order, and images are only opened once writes complete.
+class DiskWriter
+{
+public:
+    struct Job
+    {
+        std::string path;
+        std::vector<ImageWrite> regions;
+        bool replace = false;
+        bool sync = false;
+    };
+
+    ~DiskWriter()
+    {
+        if (m_thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_exit = true;
+            }
+            m_cv.notify_all();
+            m_thread.join();
+        }
+    }
+
+    void Queue(Job&& job)
+    {
+        ReportErrors();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable())
+            m_thread = std::thread(&DiskWriter::ThreadProc, this);
+
+        m_jobs.push_back(std::move(job));
+        m_cv.notify_all();
+    }
+
+    void Wait()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_jobs.empty() && !m_busy; });
+        }
+
+        ReportErrors();
+    }
+
+protected:
+    void ThreadProc()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        for (;;)
+        {
+            m_cv.wait(lock, [&] { return !m_jobs.empty() || m_exit; });
+            if (m_jobs.empty())
+                break;
+
+            auto job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_busy = true;
+            lock.unlock();
+
+            auto ok = Run(job);
+
+            lock.lock();
+            if (!ok)
+                m_failed_path = job.path;
+
+            m_busy = false;
+            m_cv.notify_all();
+        }
+    }
+
+    static bool Run(const Job& job)
+    {
+        if (job.replace)
+            return Replace(job);
+
+        // Write the changed regions in place
+        unique_FILE file = fopen(job.path.c_str(), "r+b");
+        auto ok = file != nullptr;
+
+        for (auto& region : job.regions)
+            ok = ok && WriteFileData(file, region.offset, region.data.data(), region.data.size());
+
+        return ok && (!job.sync || SyncFile(file));
+    }
+
+    // Write a complete new image alongside the original, and only rename it over
+    // the original once it's safely on disk, so a failed write leaves it intact
+    static bool Replace(const Job& job)
+    {
+        auto temp_path = fmt::format("{}.{:08x}.tmp", job.path, std::random_device{}());
+        unique_FILE file = fopen(temp_path.c_str(), "wb");
+        auto ok = file != nullptr;
+
+        for (auto& region : job.regions)
+            ok = ok && WriteFileData(file, region.offset, region.data.data(), region.data.size());
+
+        ok = ok && SyncFile(file);
+        file.reset();
+
+        std::error_code ec;
+        if (ok)
+            fs::rename(temp_path, job.path, ec);
+
+        if (!ok || ec)
+        {
+            fs::remove(temp_path, ec);
+            return false;
+        }
+
+        return true;
+    }
+
+    void ReportErrors()
+    {
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::swap(path, m_failed_path);
+        }
+
+        if (!path.empty())
+            Message(MsgType::Warning, "Failed to save changes to:\n\n{}", path);
+    }
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Job> m_jobs;
+    bool m_busy = false;
+    bool m_exit = false;
+    std::string m_failed_path;
+};
+
+static DiskWriter disk_writer;
 
 DiskType Disk::GetType(Stream& stream)
 {
@@ -30,7 +203,9 @@ DiskType Disk::GetType(Stream& stream)
         return DiskType::Floppy;
     else
 #endif
-    if (EDSKDisk::IsRecognised(stream))
+    if (DirDisk::IsRecognised(stream))
+        return DiskType::Dir;
+    else if (EDSKDisk::IsRecognised(stream))
         return DiskType::EDSK;
     else if (SADDisk::IsRecognised(stream))
         return DiskType::SAD;
@@ -49,19 +224,36 @@ DiskType Disk::GetType(Stream& stream)
 std::unique_ptr<Disk>
 Disk::Open(const std::string& disk_path, bool read_only)
 {
+    // Complete any pending writes, so we see the latest image contents
+    WaitForWrites();
+
     if (auto stream = Stream::Open(disk_path, read_only))
     {
-        switch (GetType(*stream))
+        // Cached images remember their type, saving the detection
+        auto cached_type = stream->CachedType();
+        auto type = cached_type ? static_cast<DiskType>(*cached_type) : GetType(*stream);
+        if (!cached_type)
+            stream->SetCachedType(static_cast<int>(type));
+
+        std::unique_ptr<Disk> disk;
+        switch (type)
         {
 #ifdef _WIN32
         case DiskType::Floppy:  return std::make_unique<FloppyDisk>(std::move(stream));
 #endif
-        case DiskType::EDSK:    return std::make_unique<EDSKDisk>(std::move(stream));
-        case DiskType::SAD:     return std::make_unique<SADDisk>(std::move(stream));
-        case DiskType::MGT:     return std::make_unique<MGTDisk>(std::move(stream));
-        case DiskType::SBT:     return std::make_unique<FileDisk>(std::move(stream));
+        case DiskType::EDSK:    disk = std::make_unique<EDSKDisk>(std::move(stream)); break;
+        case DiskType::SAD:     disk = std::make_unique<SADDisk>(std::move(stream)); break;
+        case DiskType::MGT:     disk = std::make_unique<MGTDisk>(std::move(stream)); break;
+        case DiskType::SBT:     disk = std::make_unique<FileDisk>(std::move(stream)); break;
+        case DiskType::Dir:     disk = std::make_unique<DirDisk>(std::move(stream)); break;
         default: break;
         }
+
+        // Image files are left untouched in overlay mode, which doesn't apply to real disks
+        if (disk)
+            disk->m_overlay = GetOption(diskoverlay) && !read_only;
+
+        return disk;
     }
 
     return nullptr;
@@ -83,12 +275,106 @@ Disk::Disk(std::unique_ptr<Stream> stream, DiskType type)
 
 void Disk::Close()
 {
-    if (m_modified)
+    if (m_modified && !m_overlay && !SaveChanges(GetOption(disksync) != 0))
         Save();
 
     m_stream->Close();
 }
 
+// Periodic background save of changes, for images that support it
+void Disk::AutoSave()
+{
+    if (m_modified && !m_overlay)
+        SaveChanges(GetOption(disksync) == 2);
+}
+
+// Write overlay changes through to the image file
+bool Disk::Commit()
+{
+    if (m_modified && !SaveChanges(true) && !Save())
+        return false;
+
+    WaitForWrites();
+    return true;
+}
+
+void Disk::WaitForWrites()
+{
+    disk_writer.Wait();
+}
+
+// Time opening an image and reading every sector from it, for comparing image
+// storage. Weak sectors are those giving different data on successive reads.
+std::string Disk::Benchmark(const std::string& disk_path)
+{
+    constexpr int bench_opens = 100;
+    constexpr int bench_passes = 100;
+    using namespace std::chrono;
+
+    std::unique_ptr<Disk> disk;
+    auto start_time = high_resolution_clock::now();
+
+    for (int i = 0; i < bench_opens; ++i)
+    {
+        if (!(disk = Open(disk_path, true)))
+            return fmt::format("Failed to open disk image:\n\n{}", disk_path);
+    }
+
+    auto open_time = duration<double, std::micro>(high_resolution_clock::now() - start_time).count() / bench_opens;
+
+    size_t sectors = 0, bytes = 0;
+    uint32_t checksum = 0;
+    start_time = high_resolution_clock::now();
+
+    for (int pass = 0; pass < bench_passes; ++pass)
+    {
+        for (uint8_t cyl = 0; cyl < MAX_DISK_CYLS; ++cyl)
+        {
+            for (uint8_t head = 0; head < MAX_DISK_HEADS; ++head)
+            {
+                for (uint8_t index = 0; ; ++index)
+                {
+                    auto [status, id] = disk->GetSector(cyl, head, index);
+                    if (status & RECORD_NOT_FOUND)
+                        break;
+
+                    auto [data_status, data] = disk->ReadData(cyl, head, index);
+                    if (!data.empty())
+                        checksum += data[0] + data[data.size() - 1];
+
+                    sectors++;
+                    bytes += data.size();
+                }
+            }
+        }
+    }
+
+    auto read_time = duration<double, std::nano>(high_resolution_clock::now() - start_time).count();
+
+    size_t weak_sectors = 0;
+    for (uint8_t cyl = 0; cyl < MAX_DISK_CYLS; ++cyl)
+    {
+        for (uint8_t head = 0; head < MAX_DISK_HEADS; ++head)
+        {
+            for (uint8_t index = 0; !(disk->GetSector(cyl, head, index).first & RECORD_NOT_FOUND); ++index)
+            {
+                auto data = disk->ReadData(cyl, head, index).second;
+                std::vector<uint8_t> first(data.begin(), data.end());
+                data = disk->ReadData(cyl, head, index).second;
+                weak_sectors += !std::equal(first.begin(), first.end(), data.begin(), data.end());
+            }
+        }
+    }
+
+    return fmt::format(
+        "Disk benchmark: {}\n"
+        "  open: {:.0f}us per image\n"
+        "  read: {} sectors ({} bytes) per pass, {:.1f}ns per sector\n"
+        "  weak sectors: {} (checksum {:08x})",
+        disk_path, open_time, sectors / bench_passes, bytes / bench_passes,
+        sectors ? read_time / sectors : 0.0, weak_sectors, checksum);
+}
+
 std::pair<uint8_t, IDFIELD>
 Disk::GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index)
 {
@@ -106,6 +392,65 @@ Disk::GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index)
     return std::make_pair(0, id);
 }
 
+// Map uncompressed image data directly from the file, rather than reading it into memory
+bool Disk::MapImage(size_t offset, size_t size)
+{
+    auto mapped = m_stream->Map();
+    if (!mapped || mapped->Data().size() < offset + size)
+        return false;
+
+    m_image = mapped->Data().subspan(offset, size);
+    m_mapped = std::move(mapped);
+    return true;
+}
+
+// Copy mapped image data into memory, so the file can be rewritten
+void Disk::UnmapImage()
+{
+    if (m_mapped)
+    {
+        m_data.assign(m_image.begin(), m_image.end());
+        m_image = m_data;
+        m_mapped.reset();
+    }
+}
+
+// Changes can be written in place if the file already holds a complete image
+bool Disk::CanWriteInPlace(size_t file_size)
+{
+    return m_stream->IsRawFile() && !m_stream->WriteProtected() && m_stream->GetSize() == file_size;
+}
+
+// Snapshot the modified tracks as file regions, merging neighbouring tracks
+std::vector<ImageWrite> Disk::DirtyRegions(size_t track_size, size_t file_offset)
+{
+    std::vector<ImageWrite> regions;
+
+    for (size_t track = 0; track < m_dirty_tracks.size(); track++)
+    {
+        if (!m_dirty_tracks[track])
+            continue;
+
+        auto offset = track * track_size;
+        auto data = m_image.subspan(offset, track_size);
+
+        if (!regions.empty() && regions.back().offset + regions.back().data.size() == file_offset + offset)
+            regions.back().data.insert(regions.back().data.end(), data.begin(), data.end());
+        else
+            regions.push_back({ file_offset + offset, std::vector<uint8_t>(data.begin(), data.end()) });
+
+        m_dirty_tracks[track] = false;
+    }
+
+    return regions;
+}
+
+void Disk::QueueWrite(std::vector<ImageWrite> regions, bool replace, bool sync)
+{
+    disk_writer.Queue({ GetPath(), std::move(regions), replace, sync });
+    m_modified = false;
+}
+
 bool Disk::IsBusy(uint8_t& status, bool wait)
 {
     status = 0;
@@ -131,18 +476,26 @@ bool MGTDisk::IsRecognised(Stream& stream)
 MGTDisk::MGTDisk(std::unique_ptr<Stream> stream, int num_sectors)
     : Disk(std::move(stream), DiskType::MGT), m_sectors(num_sectors)
 {
-    if (m_stream->GetSize())
+    if (auto size = m_stream->GetSize())
     {
-        m_data.resize(m_stream->GetSize());
-        m_stream->Rewind();
-        m_stream->Read(m_data.data(), m_data.size());
+        if (!MapImage(0, size))
+        {
+            m_data.resize(size);
+            m_stream->Rewind();
+            m_stream->Read(m_data.data(), m_data.size());
+            m_image = m_data;
+        }
+
         m_stream->Close();
-        m_sectors = static_cast<int>(m_data.size() / (MGT_DISK_CYLS * MGT_DISK_HEADS * NORMAL_SECTOR_SIZE));
+        m_sectors = static_cast<int>(m_image.size() / (MGT_DISK_CYLS * MGT_DISK_HEADS * NORMAL_SECTOR_SIZE));
     }
     else
     {
         m_data.resize((num_sectors == DOS_DISK_SECTORS) ? DOS_IMAGE_SIZE : MGT_IMAGE_SIZE);
+        m_image = m_data;
     }
+
+    m_dirty_tracks.resize(MGT_DISK_CYLS * MGT_DISK_HEADS);
 }
 
 std::pair<uint8_t, IDFIELD>
@@ -154,19 +507,17 @@ MGTDisk::GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index)
     return Disk::GetSector(cyl, head, sector_index);
 }
 
-std::pair<uint8_t, std::vector<uint8_t>>
+std::pair<uint8_t, span<const uint8_t>>
 MGTDisk::ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index)
 {
     if (sector_index >= m_sectors)
-        return std::make_pair(RECORD_NOT_FOUND, std::vector<uint8_t>());
+        return std::make_pair(RECORD_NOT_FOUND, span<const uint8_t>());
 
     auto offset = ((static_cast<size_t>(cyl) * MGT_DISK_HEADS + head) * m_sectors + sector_index) * NORMAL_SECTOR_SIZE;
-    auto data = std::vector<uint8_t>(m_data.begin() + offset, m_data.begin() + offset + NORMAL_SECTOR_SIZE);
-
-    return std::make_pair(0, std::move(data));
+    return std::make_pair(0, m_image.subspan(offset, NORMAL_SECTOR_SIZE));
 }
 
-uint8_t MGTDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, const std::vector<uint8_t>& data)
+uint8_t MGTDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, span<const uint8_t> data)
 {
     if (sector_index >= m_sectors || data.size() != NORMAL_SECTOR_SIZE)
         return RECORD_NOT_FOUND;
@@ -175,7 +526,8 @@ uint8_t MGTDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, cons
         return WRITE_PROTECT;
 
     auto offset = ((static_cast<size_t>(cyl) * MGT_DISK_HEADS + head) * m_sectors + sector_index) * NORMAL_SECTOR_SIZE;
-    std::copy(data.begin(), data.end(), m_data.begin() + offset);
+    std::copy(data.begin(), data.end(), m_image.begin() + offset);
+    MarkDirty(static_cast<size_t>(cyl) * MGT_DISK_HEADS + head);
     m_modified = true;
 
     return 0;
@@ -183,14 +535,26 @@ uint8_t MGTDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, cons
 
 bool MGTDisk::Save()
 {
+    UnmapImage();
+
     m_stream->Rewind();
-    auto saved = m_stream->Write(m_data.data(), m_data.size()) == m_data.size();
+    auto saved = m_stream->Write(m_image.data(), m_image.size()) == m_image.size();
     m_stream->Close();
 
+    std::fill(m_dirty_tracks.begin(), m_dirty_tracks.end(), false);
     m_modified = false;
     return saved;
 }
 
+bool MGTDisk::SaveChanges(bool sync)
+{
+    if (!CanWriteInPlace(m_image.size()))
+        return false;
+
+    QueueWrite(DirtyRegions(m_sectors * NORMAL_SECTOR_SIZE, 0), false, sync);
+    return true;
+}
+
 uint8_t MGTDisk::FormatTrack(uint8_t cyl, uint8_t head,
     const std::vector<std::pair<IDFIELD, std::vector<uint8_t>>>& sectors)
 {
@@ -217,9 +581,10 @@ uint8_t MGTDisk::FormatTrack(uint8_t cyl, uint8_t head,
     for (auto& [id, data] : sectors)
     {
         auto sector_offset = (id.sector - 1) * NORMAL_SECTOR_SIZE;
-        std::copy(data.begin(), data.end(), m_data.begin() + track_offset + sector_offset);
+        std::copy(data.begin(), data.end(), m_image.begin() + track_offset + sector_offset);
     }
 
+    MarkDirty(static_cast<size_t>(cyl) * MGT_DISK_HEADS + head);
     m_modified = true;
     return 0;
 }
@@ -255,15 +620,24 @@ SADDisk::SADDisk(std::unique_ptr<Stream> stream)
         m_cyls = sh.cyls;
         m_sectors = sh.sectors;
         m_sector_size = sh.sector_size_div64 << 6;
-        m_data.resize(static_cast<size_t>(m_cyls) * m_heads * m_sectors * m_sector_size);
+        auto size = static_cast<size_t>(m_cyls) * m_heads * m_sectors * m_sector_size;
+
+        if (!MapImage(sizeof(sh), size))
+        {
+            m_data.resize(size);
+            m_stream->Read(m_data.data(), m_data.size());
+            m_image = m_data;
+        }
 
-        m_stream->Read(m_data.data(), m_data.size());
         m_stream->Close();
     }
     else
     {
         m_data.resize(m_cyls * m_heads * m_sectors * m_sector_size);
+        m_image = m_data;
     }
+
+    m_dirty_tracks.resize(static_cast<size_t>(m_cyls) * m_heads);
 }
 
 std::pair<uint8_t, IDFIELD>
@@ -277,18 +651,16 @@ SADDisk::GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index)
     return std::make_pair(status, id);
 }
 
-std::pair<uint8_t, std::vector<uint8_t>>
+std::pair<uint8_t, span<const uint8_t>>
 SADDisk::ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index)
 {
     size_t offset = (head * m_cyls + cyl) * (m_sectors * m_sector_size) +
         (sector_index * m_sector_size);
 
-    return std::make_pair(0, std::vector<uint8_t>(
-        m_data.begin() + offset,
-        m_data.begin() + offset + m_sector_size));
+    return std::make_pair(0, m_image.subspan(offset, m_sector_size));
 }
 
-uint8_t SADDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, const std::vector<uint8_t>& data)
+uint8_t SADDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, span<const uint8_t> data)
 {
     if (sector_index >= m_sectors || data.size() != m_sector_size)
         return RECORD_NOT_FOUND;
@@ -297,7 +669,8 @@ uint8_t SADDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, cons
         return WRITE_PROTECT;
 
     auto offset = (head * m_cyls + cyl) * (m_sectors * m_sector_size) + (sector_index * m_sector_size);
-    std::copy(data.begin(), data.end(), m_data.begin() + offset);
+    std::copy(data.begin(), data.end(), m_image.begin() + offset);
+    MarkDirty(static_cast<size_t>(head) * m_cyls + cyl);
     m_modified = true;
 
     return 0;
@@ -312,15 +685,27 @@ bool SADDisk::Save()
     sh.sectors = static_cast<uint8_t>(m_sectors);
     sh.sector_size_div64 = static_cast<uint8_t>(m_sector_size >> 6);
 
+    UnmapImage();
+
     m_stream->Rewind();
     auto saved = m_stream->Write(&sh, sizeof(sh)) == sizeof(sh) &&
-        m_stream->Write(m_data.data(), m_data.size()) == m_data.size();
+        m_stream->Write(m_image.data(), m_image.size()) == m_image.size();
     m_stream->Close();
 
+    std::fill(m_dirty_tracks.begin(), m_dirty_tracks.end(), false);
     m_modified = false;
     return saved;
 }
 
+bool SADDisk::SaveChanges(bool sync)
+{
+    if (!CanWriteInPlace(sizeof(SAD_HEADER) + m_image.size()))
+        return false;
+
+    QueueWrite(DirtyRegions(m_sectors * m_sector_size, sizeof(SAD_HEADER)), false, sync);
+    return true;
+}
+
 uint8_t SADDisk::FormatTrack(uint8_t cyl, uint8_t head,
     const std::vector<std::pair<IDFIELD, std::vector<uint8_t>>>& sectors)
 {
@@ -340,14 +725,15 @@ uint8_t SADDisk::FormatTrack(uint8_t cyl, uint8_t head,
     if (!normal)
         return WRITE_PROTECT;
 
-    auto track_offset = sizeof(SAD_HEADER) + (head * m_cyls + cyl) * (m_sectors * NORMAL_SECTOR_SIZE);
+    auto track_offset = (head * m_cyls + cyl) * (m_sectors * m_sector_size);
 
     for (auto& [id, data] : sectors)
     {
         auto sector_offset = (id.sector - 1) * m_sector_size;
-        std::copy(data.begin(), data.end(), m_data.begin() + track_offset + sector_offset);
+        std::copy(data.begin(), data.end(), m_image.begin() + track_offset + sector_offset);
     }
 
+    MarkDirty(static_cast<size_t>(head) * m_cyls + cyl);
     m_modified = true;
     return 0;
 }
@@ -363,14 +749,27 @@ bool EDSKDisk::IsRecognised(Stream& stream)
             std::string_view(eh.signature, DSK_SIGNATURE.size()) == DSK_SIGNATURE);
 }
 
+// Weak sectors are stored as multiple complete copies of the sector data
+static uint8_t SectorCopies(size_t data_size, size_t sector_size)
+{
+    if (data_size <= sector_size || (data_size % sector_size) != 0)
+        return 1;
+
+    return static_cast<uint8_t>(std::min(data_size / sector_size, size_t{ 0xff }));
+}
+
 EDSKDisk::EDSKDisk(std::unique_ptr<Stream> stream, int cyls, int heads)
     : Disk(std::move(stream), DiskType::EDSK), m_cyls(cyls), m_heads(heads)
 {
     m_tracks.resize(MAX_DISK_CYLS * MAX_DISK_HEADS);
 
-    if (!m_stream->GetSize())
+    auto stream_size = m_stream->GetSize();
+    if (!stream_size)
         return;
 
+    // Track data is read straight into the arena, so a single allocation covers the image
+    m_arena.reserve(stream_size);
+
     EDSK_HEADER eh{};
     m_stream->Rewind();
     m_stream->Read(&eh, sizeof(eh));
@@ -385,61 +784,147 @@ EDSKDisk::EDSKDisk(std::unique_ptr<Stream> stream, int cyls, int heads)
     {
         for (uint8_t head = 0; head < m_heads; head++)
         {
-            auto edsk_track_size = eh.size_msbs[cyl * m_heads + head] << 8;
+            size_t edsk_track_size = eh.size_msbs[cyl * m_heads + head] << 8;
             auto track_size = is_dsk ? dsk_track_size : edsk_track_size;
             if (!track_size)
                 continue;
 
             EDSK_TRACK et{};
             if (m_stream->Read(&et, sizeof(et)) != sizeof(et) ||
-                std::string_view(et.signature, EDSK_TRACK_SIGNATURE.size()) != EDSK_TRACK_SIGNATURE)
+                std::string_view(et.signature, EDSK_TRACK_SIGNATURE.size()) != EDSK_TRACK_SIGNATURE ||
+                et.sectors > EDSK_MAX_SECTORS)
             {
+                m_stream->Close();
                 return;
             }
 
-            std::vector<std::pair<EDSK_SECTOR, std::vector<uint8_t>>> track;
-            track.resize(et.sectors);
-
-            for (auto& s : track)
+            std::array<EDSK_SECTOR, EDSK_MAX_SECTORS> headers{};
+            auto headers_size = sizeof(EDSK_SECTOR) * et.sectors;
+            if (m_stream->Read(headers.data(), headers_size) != headers_size)
             {
-                auto& [sector, data] = s;
-                if (m_stream->Read(&sector, sizeof(sector)) != sizeof(sector))
-                    return;
+                m_stream->Close();
+                return;
             }
 
-            auto slack_size = (0x100 - sizeof(EDSK_TRACK) - sizeof(EDSK_SECTOR) * et.sectors) & 0xff;
-            std::vector<uint8_t> slack(slack_size);
-            m_stream->Read(slack.data(), slack.size());
+            std::array<uint8_t, 0x100> slack{};
+            m_stream->Read(slack.data(), (0x100 - sizeof(EDSK_TRACK) - headers_size) & 0xff);
 
-            for (auto& [sector, data] : track)
+            // The track data block follows the 256-byte track header, padded to a 256-byte multiple
+            auto block_start = m_arena.size();
+            auto block_size = (track_size > 0x100) ? track_size - 0x100 : 0;
+            m_arena.resize(block_start + block_size);
+            auto block_read = m_stream->Read(m_arena.data() + block_start, block_size);
+            m_arena.resize(block_start + block_read);
+
+            if ((et.data_rate != 0 && et.data_rate != 1) || (et.data_encoding != 0 && et.data_encoding != 1))
             {
-                size_t data_size = (sector.data_high << 8) | sector.data_low;
-                data.resize(data_size);
-                if (m_stream->Read(data.data(), data.size()) != data.size())
-                    return;
+                m_arena.resize(block_start);
+            }
+            else
+            {
+                auto& track = m_tracks[static_cast<size_t>(cyl) * m_heads + head];
+                track.first_sector = m_sectors.size();
+                track.sectors = et.sectors;
+
+                auto offset = block_start;
+                auto block_end = block_start + block_read;
+
+                for (uint8_t i = 0; i < et.sectors; ++i)
+                {
+                    auto& header = headers[i];
+                    auto sector_size = SizeFromSizeCode(header.size);
+                    size_t data_size = is_dsk ? SizeFromSizeCode(et.size) : ((header.data_high << 8) | header.data_low);
+                    auto available = std::min(data_size, block_end - std::min(offset, block_end));
+
+                    if (available == data_size && data_size >= sector_size)
+                    {
+                        // Complete data is referenced in place
+                        SectorRef ref;
+                        ref.header = header;
+                        ref.offset = offset;
+                        ref.size = data_size;
+                        ref.copies = SectorCopies(data_size, sector_size);
+                        m_sectors.push_back(ref);
+                    }
+                    else
+                    {
+                        // Short data is padded to the full sector size, in a new copy
+                        std::vector<uint8_t> data(m_arena.begin() + offset, m_arena.begin() + offset + available);
+                        AppendSector(header, data);
+                        m_arena_unused += available;
+                    }
+
+                    offset += data_size;
+                }
+
+                m_arena_unused += block_end - std::min(offset, block_end);
+            }
 
-                data_size = SizeFromSizeCode(sector.size);
-                data.resize(data_size);
+            if (block_read != block_size)
+            {
+                m_stream->Close();
+                return;
             }
+        }
+    }
 
-            if ((et.data_rate != 0 && et.data_rate != 1) || (et.data_encoding != 0 && et.data_encoding != 1))
-                track.clear();
+    m_stream->Close();
+}
+
+void EDSKDisk::AppendSector(const EDSK_SECTOR& header, span<const uint8_t> data)
+{
+    auto sector_size = SizeFromSizeCode(header.size);
+
+    SectorRef ref;
+    ref.header = header;
+    ref.offset = m_arena.size();
+    ref.size = std::max(data.size(), sector_size);
+    ref.copies = SectorCopies(data.size(), sector_size);
+
+    m_arena.insert(m_arena.end(), data.begin(), data.end());
+    m_arena.resize(ref.offset + ref.size);
+    m_sectors.push_back(ref);
+}
+
+// Rebuild the arena and sector list in track order, dropping unreferenced data
+void EDSKDisk::CompactArena()
+{
+    std::vector<uint8_t> arena;
+    arena.reserve(m_arena.size() - m_arena_unused);
+
+    std::vector<SectorRef> sectors;
+    sectors.reserve(m_sectors.size());
 
-            m_tracks[static_cast<size_t>(cyl) * m_heads + head] = std::move(track);
+    for (auto& track : m_tracks)
+    {
+        auto first_sector = sectors.size();
+
+        for (uint8_t i = 0; i < track.sectors; ++i)
+        {
+            auto ref = m_sectors[track.first_sector + i];
+            auto data = m_arena.begin() + ref.offset;
+
+            ref.offset = arena.size();
+            arena.insert(arena.end(), data, data + ref.size);
+            sectors.push_back(ref);
         }
+
+        track.first_sector = first_sector;
     }
 
-    m_stream->Close();
+    m_arena = std::move(arena);
+    m_sectors = std::move(sectors);
+    m_arena_unused = 0;
 }
 
 std::pair<uint8_t, IDFIELD>
 EDSKDisk::GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index)
 {
     auto entry = static_cast<size_t>(cyl) * m_heads + head;
-    if (entry >= m_tracks.size() || sector_index >= m_tracks[entry].size())
+    if (entry >= m_tracks.size() || sector_index >= m_tracks[entry].sectors)
         return std::make_pair(RECORD_NOT_FOUND, IDFIELD{});
 
-    auto& [sector, data] = m_tracks[entry][sector_index];
+    auto& sector = m_sectors[m_tracks[entry].first_sector + sector_index].header;
 
     IDFIELD id{};
     id.cyl = sector.cyl;
@@ -461,28 +946,32 @@ EDSKDisk::GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index)
     return std::make_pair(status, id);
 }
 
-std::pair<uint8_t, std::vector<uint8_t>>
+std::pair<uint8_t, span<const uint8_t>>
 EDSKDisk::ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index)
 {
     auto [status, id] = GetSector(cyl, head, sector_index);
     if (status & RECORD_NOT_FOUND)
-        return std::make_pair(RECORD_NOT_FOUND, std::vector<uint8_t>());
+        return std::make_pair(RECORD_NOT_FOUND, span<const uint8_t>());
 
     auto entry = static_cast<size_t>(cyl) * m_heads + head;
-    auto [sector, data] = m_tracks[entry][sector_index];
+    auto& ref = m_sectors[m_tracks[entry].first_sector + sector_index];
+    auto& sector = ref.header;
 
-    auto data_size = SizeFromSizeCode(sector.size);
-    data.resize(data_size);
+    // Weak sectors cycle through their stored copies on successive reads
+    auto sector_size = SizeFromSizeCode(sector.size);
+    auto offset = ref.offset + ref.next_copy * sector_size;
+    if (ref.copies > 1)
+        ref.next_copy = (ref.next_copy + 1) % ref.copies;
 
     status = 0;
     if (sector.status2 & ST2_765_DATA_NOT_FOUND) status |= RECORD_NOT_FOUND;
     if (sector.status2 & ST2_765_CRC_ERROR) { status |= CRC_ERROR; }
     if (sector.status2 & ST2_765_CONTROL_MARK)   status |= DELETED_DATA;
 
-    return std::make_pair(status, std::move(data));
+    return std::make_pair(status, span<const uint8_t>(m_arena.data() + offset, sector_size));
 }
 
-uint8_t EDSKDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, const std::vector<uint8_t>& data)
+uint8_t EDSKDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, span<const uint8_t> data)
 {
     auto [status, id] = GetSector(cyl, head, sector_index);
     if (status & RECORD_NOT_FOUND)
@@ -492,13 +981,20 @@ uint8_t EDSKDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, con
         return WRITE_PROTECT;
 
     auto entry = static_cast<size_t>(cyl) * m_heads + head;
-    auto& [sector, sector_data] = m_tracks[entry][sector_index];
+    auto& ref = m_sectors[m_tracks[entry].first_sector + sector_index];
+    auto& sector = ref.header;
 
     auto data_size = SizeFromSizeCode(sector.size);
     if (data.size() != data_size)
         return RECORD_NOT_FOUND;
 
-    sector_data = data;
+    // The written sector is no longer weak, so only the first copy is kept
+    std::copy(data.begin(), data.end(), m_arena.begin() + ref.offset);
+    m_arena_unused += ref.size - data_size;
+    ref.size = data_size;
+    ref.copies = 1;
+    ref.next_copy = 0;
+
     m_modified = true;
     sector.status1 &= ~ST1_765_CRC_ERROR;
     sector.status2 &= ~ST2_765_CRC_ERROR;
@@ -506,8 +1002,16 @@ uint8_t EDSKDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, con
     return 0;
 }
 
-bool EDSKDisk::Save()
+// Build the complete EDSK image, for saving
+std::vector<uint8_t> EDSKDisk::ImageData() const
 {
+    std::vector<uint8_t> image;
+    auto append = [&](const void* data, size_t len)
+    {
+        auto pb = static_cast<const uint8_t*>(data);
+        image.insert(image.end(), pb, pb + len);
+    };
+
     EDSK_HEADER eh{};
     EDSK_SIGNATURE.copy(&eh.signature[0], sizeof(eh.signature));
     EDSK_SIMCOUPE_CREATOR.copy(&eh.creator[0], sizeof(eh.creator));
@@ -520,15 +1024,15 @@ bool EDSKDisk::Save()
         {
             auto entry = static_cast<size_t>(cyl) * m_heads + head;
             auto& track = m_tracks[entry];
-            auto track_size = sizeof(EDSK_TRACK);
-            track_size += std::accumulate(track.begin(), track.end(), size_t{ 0 },
-                [](size_t val, auto& s) { return val + s.second.size(); });
+            size_t track_size = 0x100;
+            for (uint8_t i = 0; i < track.sectors; ++i)
+                track_size += m_sectors[track.first_sector + i].size;
             eh.size_msbs[entry] = static_cast<uint8_t>((track_size + 0xff) >> 8);
         }
     }
 
-    m_stream->Rewind();
-    bool saved = m_stream->Write(&eh, sizeof(eh)) == sizeof(eh);
+    image.reserve(sizeof(eh) + m_arena.size() - m_arena_unused + m_cyls * m_heads * 0x200);
+    append(&eh, sizeof(eh));
 
     for (auto cyl = 0; cyl < m_cyls; cyl++)
     {
@@ -542,30 +1046,63 @@ bool EDSKDisk::Save()
             et.cyl = cyl;
             et.head = head;
             et.size = 2;
-            et.sectors = static_cast<uint8_t>(track.size());
-            et.size = 2;
+            et.sectors = track.sectors;
             et.gap3 = 0x4e;
             et.fill = 0x00;
 
-            saved &= m_stream->Write(&et, sizeof(et)) == sizeof(et);
+            append(&et, sizeof(et));
 
-            for (auto& [sector, data] : track)
-                saved &= m_stream->Write(&sector, sizeof(sector)) == sizeof(sector);
+            for (uint8_t i = 0; i < track.sectors; ++i)
+            {
+                auto& ref = m_sectors[track.first_sector + i];
+                auto sector = ref.header;
+                sector.data_low = static_cast<uint8_t>(ref.size & 0xff);
+                sector.data_high = static_cast<uint8_t>(ref.size >> 8);
+                append(&sector, sizeof(sector));
+            }
 
             auto slack_size = (0x100 - sizeof(EDSK_TRACK) - sizeof(EDSK_SECTOR) * et.sectors) & 0xff;
-            std::vector<uint8_t> slack(slack_size);
-            saved &= m_stream->Write(slack.data(), slack.size()) == slack.size();
+            image.resize(image.size() + slack_size);
 
-            for (auto& [sector, data] : track)
-                saved &= m_stream->Write(data.data(), data.size()) == data.size();
+            for (uint8_t i = 0; i < track.sectors; ++i)
+            {
+                auto& ref = m_sectors[track.first_sector + i];
+                append(m_arena.data() + ref.offset, ref.size);
+            }
+
+            // Pad the track data to the 256-byte multiple given in the header
+            image.resize((image.size() + 0xff) & ~size_t{ 0xff });
         }
     }
 
+    return image;
+}
+
+bool EDSKDisk::Save()
+{
+    auto image = ImageData();
+
+    m_stream->Rewind();
+    bool saved = m_stream->Write(image.data(), image.size()) == image.size();
+
     m_stream->Close();
     m_modified = false;
     return saved;
 }
 
+// The layout changes with track contents, so changes are saved as a complete
+// replacement image, written to a temporary file and renamed over the original
+bool EDSKDisk::SaveChanges(bool sync)
+{
+    if (!m_stream->IsRawFile() || m_stream->WriteProtected())
+        return false;
+
+    std::vector<ImageWrite> regions;
+    regions.push_back({ 0, ImageData() });
+    QueueWrite(std::move(regions), true, sync);
+    return true;
+}
+
 uint8_t EDSKDisk::FormatTrack(uint8_t cyl, uint8_t head,
     const std::vector<std::pair<IDFIELD, std::vector<uint8_t>>>& sectors)
 {
@@ -576,8 +1113,13 @@ uint8_t EDSKDisk::FormatTrack(uint8_t cyl, uint8_t head,
     if (entry >= m_tracks.size())
         return WRITE_PROTECT;
 
+    // The new sectors are appended, leaving the old track data unreferenced
     auto& track = m_tracks[entry];
-    track.clear();
+    for (uint8_t i = 0; i < track.sectors; ++i)
+        m_arena_unused += m_sectors[track.first_sector + i].size;
+
+    track.first_sector = m_sectors.size();
+    track.sectors = static_cast<uint8_t>(sectors.size());
 
     for (auto& [id, data] : sectors)
     {
@@ -586,12 +1128,15 @@ uint8_t EDSKDisk::FormatTrack(uint8_t cyl, uint8_t head,
         es.head = id.head;
         es.sector = id.sector;
         es.size = id.size;
-        es.data_low = static_cast<uint8_t>(data.size() & 0xff);
-        es.data_high = static_cast<uint8_t>(data.size() >> 8);
 
-        track.push_back(std::make_pair(es, data));
+        // Store the data at the size given by the size code, as when loading
+        auto data_size = std::min(data.size(), SizeFromSizeCode(id.size));
+        AppendSector(es, span<const uint8_t>(data).subspan(0, data_size));
     }
 
+    if (m_arena_unused > m_arena.size() / 2)
+        CompactArena();
+
     m_modified = true;
     return 0;
 }
@@ -635,10 +1180,11 @@ FileDisk::GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index)
     return Disk::GetSector(cyl, head, sector_index);
 }
 
-std::pair<uint8_t, std::vector<uint8_t>>
+std::pair<uint8_t, span<const uint8_t>>
 FileDisk::ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index)
 {
-    std::vector<uint8_t> data(NORMAL_SECTOR_SIZE);
+    auto& data = m_sector;
+    data.assign(NORMAL_SECTOR_SIZE, 0);
 
     // The first directory sector?
     if (cyl == 0 && head == 0 && sector_index == 0)
@@ -697,10 +1243,10 @@ FileDisk::ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index)
         }
     }
 
-    return std::make_pair(0, std::move(data));
+    return std::make_pair(0, span<const uint8_t>(data));
 }
 
-uint8_t FileDisk::WriteData(uint8_t, uint8_t, uint8_t, const std::vector<uint8_t>&)
+uint8_t FileDisk::WriteData(uint8_t, uint8_t, uint8_t, span<const uint8_t>)
 {
     return WRITE_PROTECT;
 }
@@ -712,6 +1258,347 @@ bool FileDisk::Save()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+constexpr size_t DIR_SECTOR_DATA_SIZE = NORMAL_SECTOR_SIZE - 2;
+
+// Files saved by the SAM, so they're presented the same way if the directory is
+// reopened (such as when the drive motor restarts) and the host file is unchanged
+struct SavedDirFile
+{
+    fs::file_time_type time;
+    size_t size;
+    std::array<uint8_t, MGT_DIR_ENTRY_SIZE> entry;
+    std::array<uint8_t, DISK_FILE_HEADER_SIZE> header;
+};
+
+static std::map<std::string, SavedDirFile> saved_dir_files;
+
+// DOS track and sector numbers for a data sector position
+static uint8_t DirDiskTrack(size_t data_sector)
+{
+    auto track = MGT_DIRECTORY_TRACKS + data_sector / MGT_DISK_SECTORS;
+    return static_cast<uint8_t>((track < MGT_DISK_CYLS) ? track : (0x80 | (track - MGT_DISK_CYLS)));
+}
+
+static uint8_t DirDiskSector(size_t data_sector)
+{
+    return static_cast<uint8_t>(MGT_FIRST_SECTOR + data_sector % MGT_DISK_SECTORS);
+}
+
+bool DirDisk::IsRecognised(Stream& stream)
+{
+    std::error_code ec;
+    return fs::is_directory(stream.GetPath(), ec);
+}
+
+DirDisk::DirDisk(std::unique_ptr<Stream> stream)
+    : Disk(std::move(stream), DiskType::Dir)
+{
+    m_files.resize(MGT_DIR_ENTRIES);
+    m_owners.assign(MGT_DATA_SECTORS, { -1, 0 });
+    m_dirty_files.resize(MGT_DIR_ENTRIES);
+
+    std::error_code ec;
+    std::vector<fs::path> host_files;
+    for (auto& dir_entry : fs::directory_iterator(GetPath(), ec))
+    {
+        if (dir_entry.is_regular_file(ec) && !OSD::IsHidden(dir_entry.path().string()) &&
+            dir_entry.file_size(ec) <= MAX_SAM_FILE_SIZE)
+        {
+            host_files.push_back(dir_entry.path());
+        }
+    }
+    std::sort(host_files.begin(), host_files.end());
+
+    std::set<std::string> sam_names;
+    size_t slot = 0, next_sector = 0;
+
+    for (auto& host_path : host_files)
+    {
+        auto host_name = host_path.filename().string();
+        auto sam_name = host_name.substr(0, 10);
+        auto size = static_cast<size_t>(fs::file_size(host_path, ec));
+        auto num_sectors = (DISK_FILE_HEADER_SIZE + size + DIR_SECTOR_DATA_SIZE - 1) / DIR_SECTOR_DATA_SIZE;
+
+        // Skip files that don't fit, or that the DOS couldn't tell apart
+        if (slot == m_files.size())
+            break;
+        else if (ec || next_sector + num_sectors > MGT_DATA_SECTORS || !sam_names.insert(tolower(sam_name)).second)
+            continue;
+
+        auto& file = m_files[slot];
+        auto& entry = file.entry;
+        auto& header = file.header;
+        file.host_name = host_name;
+        file.size = size;
+
+        // Present files saved by the SAM as they were, with others as CODE files at 32768
+        auto it = saved_dir_files.find(host_path.string());
+        if (it != saved_dir_files.end() && it->second.size == size && it->second.time == fs::last_write_time(host_path, ec))
+        {
+            entry = it->second.entry;
+            header = it->second.header;
+        }
+        else
+        {
+            header = {
+                19,                                         // CODE file type
+                static_cast<uint8_t>(size & 0xff),          // LSB of size mod 16384
+                static_cast<uint8_t>((size >> 8) & 0x3f),   // MSB of size mod 16384
+                0x00, 0x80,                                 // offset start
+                0xff, 0xff,                                 // unused
+                static_cast<uint8_t>((size >> 14) & 0x1f),  // page count
+                0x01 };                                     // first page
+
+            entry[0] = header[0];
+            std::fill(entry.begin() + 1, entry.begin() + 11, ' ');
+            std::copy(sam_name.begin(), sam_name.end(), entry.begin() + 1);
+
+            // Starting page number and offset, size in pages and mod 16384, and no auto-execute
+            entry[236] = header[8];
+            entry[237] = header[3];
+            entry[238] = header[4];
+            entry[239] = header[7];
+            entry[240] = header[1];
+            entry[241] = header[2];
+            entry[242] = 0xff;
+        }
+
+        // Sector count, start position and sector address map, for the layout here
+        entry[11] = static_cast<uint8_t>(num_sectors >> 8);
+        entry[12] = static_cast<uint8_t>(num_sectors & 0xff);
+        entry[13] = DirDiskTrack(next_sector);
+        entry[14] = DirDiskSector(next_sector);
+        std::fill(entry.begin() + 15, entry.begin() + 15 + MGT_DATA_SECTORS / 8, 0);
+
+        for (size_t i = 0; i < num_sectors; ++i, ++next_sector)
+        {
+            entry[15 + next_sector / 8] |= 1 << (next_sector & 7);
+            m_owners[next_sector] = { static_cast<int>(slot), i };
+        }
+
+        slot++;
+    }
+}
+
+std::pair<uint8_t, IDFIELD>
+DirDisk::GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index)
+{
+    if (cyl >= MGT_DISK_CYLS || head >= MGT_DISK_HEADS || sector_index >= MGT_DISK_SECTORS)
+        return std::make_pair(RECORD_NOT_FOUND, IDFIELD{});
+
+    return Disk::GetSector(cyl, head, sector_index);
+}
+
+std::pair<uint8_t, span<const uint8_t>>
+DirDisk::ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index)
+{
+    return std::make_pair(0, SectorData(cyl, head, sector_index));
+}
+
+uint8_t DirDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, span<const uint8_t> data)
+{
+    auto [status, id] = GetSector(cyl, head, sector_index);
+    if ((status & RECORD_NOT_FOUND) || data.size() != NORMAL_SECTOR_SIZE)
+        return RECORD_NOT_FOUND;
+    else if (WriteProtected())
+        return WRITE_PROTECT;
+
+    auto pos = (static_cast<size_t>(head) * MGT_DISK_CYLS + cyl) * MGT_DISK_SECTORS + sector_index;
+    m_written[pos].assign(data.begin(), data.end());
+    m_modified = true;
+
+    // Note the file owning a data sector, so an unchanged entry is still saved
+    if (pos >= MGT_DIRECTORY_TRACKS * MGT_DISK_SECTORS)
+    {
+        auto slot = m_owners[pos - MGT_DIRECTORY_TRACKS * MGT_DISK_SECTORS].first;
+        if (slot >= 0)
+            m_dirty_files[slot] = true;
+    }
+
+    return 0;
+}
+
+// Changes reach the host directory when the disk is closed, which includes the
+// drive motor stopping after DOS activity, rather than mid-operation
+bool DirDisk::Save()
+{
+    constexpr auto entries_per_sector = NORMAL_SECTOR_SIZE / MGT_DIR_ENTRY_SIZE;
+
+    for (size_t slot = 0; slot < m_files.size(); ++slot)
+    {
+        if (auto it = m_written.find(slot / entries_per_sector); it != m_written.end())
+        {
+            auto offset = (slot % entries_per_sector) * MGT_DIR_ENTRY_SIZE;
+            SyncEntry(slot, span<const uint8_t>(it->second).subspan(offset, MGT_DIR_ENTRY_SIZE), m_dirty_files[slot]);
+        }
+        else if (m_dirty_files[slot])
+        {
+            auto entry = m_files[slot].entry;
+            SyncEntry(slot, entry, true);
+        }
+    }
+
+    m_dirty_files.assign(m_dirty_files.size(), false);
+    m_modified = false;
+    return true;
+}
+
+span<const uint8_t> DirDisk::SectorData(uint8_t cyl, uint8_t head, uint8_t sector_index)
+{
+    auto track = static_cast<size_t>(head) * MGT_DISK_CYLS + cyl;
+    auto pos = track * MGT_DISK_SECTORS + sector_index;
+
+    if (auto it = m_written.find(pos); it != m_written.end())
+        return it->second;
+
+    auto& data = m_sector;
+    data.assign(NORMAL_SECTOR_SIZE, 0);
+
+    if (track < MGT_DIRECTORY_TRACKS)
+    {
+        for (size_t offset = 0; offset < NORMAL_SECTOR_SIZE; offset += MGT_DIR_ENTRY_SIZE)
+        {
+            auto& file = m_files[(pos * NORMAL_SECTOR_SIZE + offset) / MGT_DIR_ENTRY_SIZE];
+            if (!file.host_name.empty())
+                std::copy(file.entry.begin(), file.entry.end(), data.begin() + offset);
+        }
+    }
+    else
+    {
+        auto data_sector = pos - MGT_DIRECTORY_TRACKS * MGT_DISK_SECTORS;
+        auto [slot, chunk] = m_owners[data_sector];
+
+        if (slot >= 0)
+        {
+            auto file_data = FileData(slot);
+            auto offset = chunk * DIR_SECTOR_DATA_SIZE;
+            if (offset < file_data.size())
+            {
+                auto len = std::min(DIR_SECTOR_DATA_SIZE, file_data.size() - offset);
+                std::copy(file_data.begin() + offset, file_data.begin() + offset + len, data.begin());
+            }
+
+            // Link to the next sector of the file
+            auto& entry = m_files[slot].entry;
+            if (chunk + 1 < static_cast<size_t>((entry[11] << 8) | entry[12]))
+            {
+                data[DIR_SECTOR_DATA_SIZE] = DirDiskTrack(data_sector + 1);
+                data[DIR_SECTOR_DATA_SIZE + 1] = DirDiskSector(data_sector + 1);
+            }
+        }
+    }
+
+    return data;
+}
+
+// Host file contents, preceded by the DOS file header
+span<const uint8_t> DirDisk::FileData(size_t slot)
+{
+    auto& file = m_files[slot];
+
+    if (!file.data)
+    {
+        std::vector<uint8_t> data(file.header.begin(), file.header.end());
+        data.resize(DISK_FILE_HEADER_SIZE + file.size);
+
+        // Short reads leave zeros, to keep the layout consistent if the file changes
+        std::ifstream ifs(fs::path(GetPath()) / file.host_name, std::ios::binary);
+        ifs.read(reinterpret_cast<char*>(data.data() + DISK_FILE_HEADER_SIZE), file.size);
+
+        file.data = std::move(data);
+    }
+
+    return *file.data;
+}
+
+// Collect file data by following the sector chain from a directory entry
+std::vector<uint8_t> DirDisk::ReadChain(span<const uint8_t> entry)
+{
+    std::vector<uint8_t> file;
+    auto num_sectors = (entry[11] << 8) | entry[12];
+    uint8_t track = entry[13], sector = entry[14];
+
+    while (num_sectors-- > 0)
+    {
+        auto cyl = static_cast<uint8_t>(track & 0x7f);
+        auto head = static_cast<uint8_t>(track >> 7);
+        if (cyl >= MGT_DISK_CYLS || sector < MGT_FIRST_SECTOR || sector >= MGT_FIRST_SECTOR + MGT_DISK_SECTORS)
+            break;
+
+        auto data = SectorData(cyl, head, sector - MGT_FIRST_SECTOR);
+        file.insert(file.end(), data.begin(), data.begin() + DIR_SECTOR_DATA_SIZE);
+        track = data[DIR_SECTOR_DATA_SIZE];
+        sector = data[DIR_SECTOR_DATA_SIZE + 1];
+    }
+
+    return file;
+}
+
+// Reflect a changed directory entry or file data in the host directory
+void DirDisk::SyncEntry(size_t slot, span<const uint8_t> entry, bool data_changed)
+{
+    auto& file = m_files[slot];
+    if (!data_changed && std::equal(entry.begin(), entry.end(), file.entry.begin()))
+        return;
+
+    // Keep presenting the existing data in sectors the SAM hasn't overwritten
+    if (!file.host_name.empty())
+        FileData(slot);
+
+    fs::path dir_path = GetPath();
+    std::string host_name;
+
+    if (entry[0])
+    {
+        for (size_t i = 1; i <= 10; ++i)
+        {
+            auto ch = static_cast<char>(entry[i]);
+            host_name += (ch < ' ' || ch > '~' || strchr("\\/:*?\"<>|", ch)) ? '_' : ch;
+        }
+
+        host_name.erase(host_name.find_last_not_of(' ') + 1);
+        if (host_name.find_first_not_of('.') == std::string::npos)
+            host_name = "_" + host_name;
+
+        auto data = ReadChain(entry);
+        if (data.size() >= DISK_FILE_HEADER_SIZE)
+        {
+            size_t length = ((data[7] & 0x1f) << 14) | ((data[2] & 0x3f) << 8) | data[1];
+            length = std::min(length, data.size() - DISK_FILE_HEADER_SIZE);
+
+            auto host_path = dir_path / host_name;
+            std::ofstream ofs(host_path, std::ios::binary);
+            ofs.write(reinterpret_cast<const char*>(data.data() + DISK_FILE_HEADER_SIZE), length);
+            ofs.close();
+
+            if (!ofs)
+                Message(MsgType::Warning, "Failed to write file:\n\n{}", host_path.string());
+            else
+            {
+                std::error_code ec;
+                auto& saved = saved_dir_files[host_path.string()];
+                saved.time = fs::last_write_time(host_path, ec);
+                saved.size = length;
+                std::copy(entry.begin(), entry.end(), saved.entry.begin());
+                std::copy(data.begin(), data.begin() + DISK_FILE_HEADER_SIZE, saved.header.begin());
+            }
+        }
+    }
+
+    // Remove a renamed or erased file, unless another entry still uses the name
+    if (!file.host_name.empty() && file.host_name != host_name &&
+        std::none_of(m_files.begin(), m_files.end(), [&](auto& f) { return &f != &file && f.host_name == file.host_name; }))
+    {
+        std::error_code ec;
+        fs::remove(dir_path / file.host_name, ec);
+    }
+
+    file.host_name = host_name;
+    std::copy(entry.begin(), entry.end(), file.entry.begin());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 #ifdef _WIN32
 
 bool FloppyDisk::IsRecognised(Stream& stream)
@@ -750,17 +1637,17 @@ FloppyDisk::GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index)
     return std::make_pair(sector.status, id);
 }
 
-std::pair<uint8_t, std::vector<uint8_t>>
+std::pair<uint8_t, span<const uint8_t>>
 FloppyDisk::ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index)
 {
     if (cyl != m_track->cyl || head != m_track->head || sector_index >= m_track->sectors.size())
-        return std::make_pair(RECORD_NOT_FOUND, std::vector<uint8_t>());
+        return std::make_pair(RECORD_NOT_FOUND, span<const uint8_t>());
 
     auto& sector = m_track->sectors[sector_index];
-    return std::make_pair(sector.status, sector.data);
+    return std::make_pair(sector.status, span<const uint8_t>(sector.data));
 }
 
-uint8_t FloppyDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, const std::vector<uint8_t>& data)
+uint8_t FloppyDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, span<const uint8_t> data)
 {
     if (cyl != m_track->cyl || head != m_track->head || sector_index >= m_track->sectors.size())
         return RECORD_NOT_FOUND;
@@ -770,7 +1657,7 @@ uint8_t FloppyDisk::WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, c
     if (data.size() != data_size)
         return RECORD_NOT_FOUND;
 
-    sector.data = data;
+    sector.data.assign(data.begin(), data.end());
     m_modified = true;
     sector.status &= ~CRC_ERROR;
 
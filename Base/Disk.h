@@ -33,6 +33,9 @@ constexpr size_t NORMAL_SECTOR_SIZE = 512U;
 constexpr uint8_t MGT_SECTOR_FILL = 0x00;
 
 constexpr auto MGT_DIRECTORY_TRACKS = 4;
+constexpr size_t MGT_DIR_ENTRY_SIZE = 256;
+constexpr auto MGT_DIR_ENTRIES = MGT_DIRECTORY_TRACKS * MGT_DISK_SECTORS * NORMAL_SECTOR_SIZE / MGT_DIR_ENTRY_SIZE;
+constexpr auto MGT_DATA_SECTORS = (MGT_DISK_HEADS * MGT_DISK_CYLS - MGT_DIRECTORY_TRACKS) * MGT_DISK_SECTORS;
 constexpr auto MGT_TRACK_SIZE = MGT_DISK_SECTORS * NORMAL_SECTOR_SIZE;
 constexpr auto MGT_IMAGE_SIZE = MGT_DISK_HEADS * MGT_DISK_CYLS * MGT_TRACK_SIZE;
 
@@ -118,12 +121,19 @@ constexpr auto EDSK_MAX_SECTORS = ((0x100 - sizeof(EDSK_TRACK)) / sizeof(EDSK_SE
 
 enum class DiskType
 {
-    Unknown, Floppy, File, EDSK, SAD, MGT, SBT
+    Unknown, Floppy, File, EDSK, SAD, MGT, SBT, Dir
 };
 
 // Stay BUSY for a few status reads after each command. Needed by Pro-Dos.
 #define LOAD_DELAY  3
 
+// Block of image data to write at a file offset
+struct ImageWrite
+{
+    size_t offset;
+    std::vector<uint8_t> data;
+};
+
 class Disk
 {
     friend class Drive;
@@ -138,27 +148,47 @@ public:
 
     std::string GetPath() { return m_stream->GetPath(); }
     std::string GetFile() { return m_stream->GetName(); }
-    bool WriteProtected() const { return m_stream->WriteProtected(); }
+    bool WriteProtected() const { return !m_overlay && m_stream->WriteProtected(); }
+    bool HasOverlay() const { return m_overlay; }
 
     virtual void Close();
     virtual bool Save() = 0;
+    void AutoSave();
+    bool Commit();
+
+    static void WaitForWrites();
+    static std::string Benchmark(const std::string& disk_path);
     virtual uint8_t FormatTrack(uint8_t cyl, uint8_t head,
         const std::vector<std::pair<IDFIELD, std::vector<uint8_t>>>& sectors) { return WRITE_PROTECT; }
 
 protected:
     virtual uint8_t LoadTrack(uint8_t, uint8_t) { m_busy_frames = LOAD_DELAY; return 0; }
     virtual std::pair<uint8_t, IDFIELD> GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index) = 0;
-    virtual std::pair<uint8_t, std::vector<uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) = 0;
-    virtual uint8_t WriteData(uint8_t, uint8_t, uint8_t, const std::vector<uint8_t>&) = 0;
+    // Returned data is a view into the disk, valid until the next disk call
+    virtual std::pair<uint8_t, span<const uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) = 0;
+    virtual uint8_t WriteData(uint8_t, uint8_t, uint8_t, span<const uint8_t>) = 0;
     virtual bool IsBusy(uint8_t& status, bool wait = false);
 
+    virtual bool SaveChanges(bool sync) { return false; }
+
+    bool MapImage(size_t offset, size_t size);
+    void UnmapImage();
+    void MarkDirty(size_t track) { if (track < m_dirty_tracks.size()) m_dirty_tracks[track] = true; }
+    bool CanWriteInPlace(size_t file_size);
+    std::vector<ImageWrite> DirtyRegions(size_t track_size, size_t file_offset);
+    void QueueWrite(std::vector<ImageWrite> regions, bool replace, bool sync);
+
 protected:
     DiskType m_type = DiskType::Unknown;
     int m_busy_frames = 0;
     bool m_modified = false;
+    bool m_overlay = false;     // changes are kept in memory until committed
 
     std::unique_ptr<Stream> m_stream;
     std::vector<uint8_t> m_data;
+    std::unique_ptr<MappedFile> m_mapped;
+    span<uint8_t> m_image;      // image data, either mapped from the file or held in m_data
+    std::vector<bool> m_dirty_tracks;   // tracks modified since the last save
 };
 
 class MGTDisk : public Disk
@@ -169,9 +199,10 @@ public:
     static bool IsRecognised(Stream& stream);
 
     bool Save() override;
+    bool SaveChanges(bool sync) override;
     std::pair<uint8_t, IDFIELD> GetSector(uint8_t cyl, uint8_t head, uint8_t index) override;
-    std::pair<uint8_t, std::vector<uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t index) override;
-    uint8_t WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, const std::vector<uint8_t>& data) override;
+    std::pair<uint8_t, span<const uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t index) override;
+    uint8_t WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, span<const uint8_t> data) override;
     uint8_t FormatTrack(uint8_t cyl, uint8_t head, const std::vector<std::pair<IDFIELD, std::vector<uint8_t>>>& sectors) override;
 
 protected:
@@ -186,9 +217,10 @@ public:
     static bool IsRecognised(Stream& stream);
 
     bool Save() override;
+    bool SaveChanges(bool sync) override;
     std::pair<uint8_t, IDFIELD> GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
-    std::pair<uint8_t, std::vector<uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
-    uint8_t WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, const std::vector<uint8_t>& data) override;
+    std::pair<uint8_t, span<const uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
+    uint8_t WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, span<const uint8_t> data) override;
     uint8_t FormatTrack(uint8_t cyl, uint8_t head, const std::vector<std::pair<IDFIELD, std::vector<uint8_t>>>& sectors) override;
 
 protected:
@@ -206,16 +238,41 @@ public:
     static bool IsRecognised(Stream& pStream_);
 
     bool Save() override;
+    bool SaveChanges(bool sync) override;
     std::pair<uint8_t, IDFIELD> GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
-    std::pair<uint8_t, std::vector<uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
-    uint8_t WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, const std::vector<uint8_t>& data) override;
+    std::pair<uint8_t, span<const uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
+    uint8_t WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, span<const uint8_t> data) override;
     uint8_t FormatTrack(uint8_t cyl, uint8_t head, const std::vector<std::pair<IDFIELD, std::vector<uint8_t>>>& sectors) override;
 
+protected:
+    // Sector data lives in a single arena, with weak sectors holding multiple copies
+    struct SectorRef
+    {
+        EDSK_SECTOR header{};
+        size_t offset = 0;      // arena offset of the first copy
+        size_t size = 0;        // stored size, covering all copies
+        uint8_t copies = 1;
+        uint8_t next_copy = 0;
+    };
+
+    struct TrackRef
+    {
+        size_t first_sector = 0;
+        uint8_t sectors = 0;
+    };
+
+    std::vector<uint8_t> ImageData() const;
+    void AppendSector(const EDSK_SECTOR& header, span<const uint8_t> data);
+    void CompactArena();
+
 protected:
     int m_cyls = 0;
     int m_heads = 0;
 
-    std::vector<std::vector<std::pair<EDSK_SECTOR, std::vector<uint8_t>>>> m_tracks;
+    std::vector<TrackRef> m_tracks;
+    std::vector<SectorRef> m_sectors;
+    std::vector<uint8_t> m_arena;
+    size_t m_arena_unused = 0;  // bytes no longer referenced by any sector
 };
 
 class FileDisk final : public Disk
@@ -227,8 +284,48 @@ public:
 
     bool Save() override;
     std::pair<uint8_t, IDFIELD> GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
-    std::pair<uint8_t, std::vector<uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
-    uint8_t WriteData(uint8_t, uint8_t, uint8_t, const std::vector<uint8_t>&) override;
+    std::pair<uint8_t, span<const uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
+    uint8_t WriteData(uint8_t, uint8_t, uint8_t, span<const uint8_t>) override;
+
+protected:
+    std::vector<uint8_t> m_sector;
+};
+
+// Host directory presented as a SAMDOS disk, with the files laid out in name order.
+// File data is only read when first accessed, and files saved by the SAM are written
+// back to the directory when their directory entries are written.
+class DirDisk final : public Disk
+{
+public:
+    DirDisk(std::unique_ptr<Stream> stream);
+
+    static bool IsRecognised(Stream& stream);
+
+    bool Save() override;
+    std::pair<uint8_t, IDFIELD> GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
+    std::pair<uint8_t, span<const uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
+    uint8_t WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, span<const uint8_t> data) override;
+
+protected:
+    struct DirFile
+    {
+        std::string host_name;                          // blank for an unused entry
+        std::array<uint8_t, MGT_DIR_ENTRY_SIZE> entry{};
+        std::array<uint8_t, DISK_FILE_HEADER_SIZE> header{};
+        size_t size = 0;
+        std::optional<std::vector<uint8_t>> data;       // header and contents, once loaded
+    };
+
+    span<const uint8_t> SectorData(uint8_t cyl, uint8_t head, uint8_t sector_index);
+    span<const uint8_t> FileData(size_t slot);
+    std::vector<uint8_t> ReadChain(span<const uint8_t> entry);
+    void SyncEntry(size_t slot, span<const uint8_t> entry, bool data_changed);
+
+    std::vector<DirFile> m_files;
+    std::vector<std::pair<int, size_t>> m_owners;       // data sector to file slot and sector number
+    std::map<size_t, std::vector<uint8_t>> m_written;   // sectors written by the SAM
+    std::vector<bool> m_dirty_files;                    // file slots with data sectors written since the last save
+    std::vector<uint8_t> m_sector;
 };
 
 #ifdef _WIN32
@@ -246,8 +343,8 @@ public:
     bool Save() override;
     uint8_t LoadTrack(uint8_t cyl, uint8_t head) override;
     std::pair<uint8_t, IDFIELD> GetSector(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
-    std::pair<uint8_t, std::vector<uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
-    uint8_t WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, const std::vector<uint8_t>& data) override;
+    std::pair<uint8_t, span<const uint8_t>> ReadData(uint8_t cyl, uint8_t head, uint8_t sector_index) override;
+    uint8_t WriteData(uint8_t cyl, uint8_t head, uint8_t sector_index, span<const uint8_t> data) override;
     uint8_t FormatTrack(uint8_t cyl, uint8_t head, const std::vector<std::pair<IDFIELD, std::vector<uint8_t>>>& sectors) override;
 
     bool IsBusy(uint8_t& status, bool wait) override;
@@ -81,6 +81,20 @@ void Drive::Flush()
         m_disk->Close();
 }
 
+bool Drive::CommitOverlay()
+{
+    return !m_disk || m_disk->Commit();
+}
+
+bool Drive::DiscardOverlay()
+{
+    // Reopening the image drops the in-memory changes
+    if (m_disk && m_disk->HasOverlay())
+        return Insert(m_disk->GetPath());
+
+    return true;
+}
+
 void Drive::FrameEnd()
 {
     DiskDevice::FrameEnd();
@@ -90,6 +104,14 @@ void Drive::FrameEnd()
         m_regs.status &= ~MOTOR_ON;
         Flush();
     }
+
+    // Save changes in the background during long periods of disk activity
+    if (m_disk && GetOption(diskautosave) > 0 &&
+        ++m_autosave_frames >= GetOption(diskautosave) * EMULATED_FRAMES_PER_SECOND)
+    {
+        m_autosave_frames = 0;
+        m_disk->AutoSave();
+    }
 }
 
 void Drive::ModifyStatus(uint8_t set_bits, uint8_t reset_bits)
@@ -98,7 +120,7 @@ void Drive::ModifyStatus(uint8_t set_bits, uint8_t reset_bits)
     {
         m_motor_off_frames = FLOPPY_MOTOR_TIMEOUT;
 
-        if (!(m_regs.status & MOTOR_ON) && m_disk)
+        if (!(m_regs.status & MOTOR_ON) && m_disk && !m_disk->HasOverlay())
             Insert(m_disk->GetPath());
     }
 
@@ -152,7 +174,7 @@ void Drive::ExecuteNext()
         {
             auto [status, data] = ReadSector();
             m_data_status = status;
-            m_buffer = std::move(data);
+            m_buffer.assign(data.begin(), data.end());
             m_buffer_pos = 0;
             ModifyReadStatus();
 
@@ -348,6 +370,7 @@ uint8_t Drive::In(uint16_t port)
 
                             auto [status, data] = ReadSector();
                             m_data_status = status;
+                            m_buffer.assign(data.begin(), data.end());
                             m_buffer_pos = 0;
                             ModifyReadStatus();
                         }
@@ -570,13 +593,13 @@ Drive::FindSector()
     return std::nullopt;
 }
 
-std::pair<uint8_t, std::vector<uint8_t>>
+std::pair<uint8_t, span<const uint8_t>>
 Drive::ReadSector()
 {
     return m_disk->ReadData(m_cyl, m_head, m_sector_index);
 }
 
-uint8_t Drive::WriteSector(const std::vector<uint8_t>& data)
+uint8_t Drive::WriteSector(span<const uint8_t> data)
 {
     return m_disk->WriteData(m_cyl, m_head, m_sector_index, data);
 }
@@ -593,6 +616,96 @@ Drive::ReadAddress()
     return std::make_pair(status2, id2);
 }
 
+// Read a DOS sector, with the track number holding the head in bit 7
+span<const uint8_t> Drive::ReadFileSector(uint8_t track, uint8_t sector)
+{
+    auto cyl = static_cast<uint8_t>(track & 0x7f);
+    auto head = static_cast<uint8_t>(track >> 7);
+
+    for (uint8_t index = 0; ; ++index)
+    {
+        auto [status, id] = m_disk->GetSector(cyl, head, index);
+        if (status & RECORD_NOT_FOUND)
+            break;
+
+        if (id.cyl != cyl || id.sector != sector)
+            continue;
+
+        auto [data_status, data] = m_disk->ReadData(cyl, head, index);
+        if (status || data_status || data.size() != NORMAL_SECTOR_SIZE)
+            break;
+
+        return data;
+    }
+
+    return {};
+}
+
+// Read the data of a DOS file matching a directory type and name, following the
+// sector chain from its directory entry. Used by the DOS load trap, so only an
+// unambiguous file that reads without errors is returned.
+std::optional<std::vector<uint8_t>> Drive::ReadFile(span<const uint8_t> type_name, size_t size)
+{
+    constexpr size_t DIR_ENTRY_SIZE = 256;
+    constexpr size_t SECTOR_DATA_SIZE = NORMAL_SECTOR_SIZE - 2;
+
+    if (!m_disk || type_name.empty() || !type_name[0])
+        return std::nullopt;
+
+    std::optional<std::pair<uint8_t, uint8_t>> start;
+    size_t file_sectors = 0;
+
+    for (uint8_t track = 0; track < MGT_DIRECTORY_TRACKS; ++track)
+    {
+        for (uint8_t sector = MGT_FIRST_SECTOR; sector < MGT_FIRST_SECTOR + MGT_DISK_SECTORS; ++sector)
+        {
+            auto data = ReadFileSector(track, sector);
+            if (data.empty())
+                return std::nullopt;
+
+            for (size_t entry = 0; entry < NORMAL_SECTOR_SIZE; entry += DIR_ENTRY_SIZE)
+            {
+                auto dir = data.subspan(entry, DIR_ENTRY_SIZE);
+                if (!std::equal(type_name.begin(), type_name.end(), dir.begin()))
+                    continue;
+
+                // Leave duplicate names, such as in different sub-directories, to the DOS
+                if (start)
+                    return std::nullopt;
+
+                file_sectors = (dir[11] << 8) | dir[12];
+                start = std::make_pair(dir[13], dir[14]);
+            }
+        }
+    }
+
+    if (!start)
+        return std::nullopt;
+
+    std::vector<uint8_t> file;
+    file.reserve(DISK_FILE_HEADER_SIZE + size + SECTOR_DATA_SIZE);
+
+    auto [track, sector] = *start;
+    while (file.size() < DISK_FILE_HEADER_SIZE + size && file_sectors--)
+    {
+        auto data = ReadFileSector(track, sector);
+        if (data.empty())
+            return std::nullopt;
+
+        file.insert(file.end(), data.begin(), data.begin() + SECTOR_DATA_SIZE);
+        track = data[SECTOR_DATA_SIZE];
+        sector = data[SECTOR_DATA_SIZE + 1];
+    }
+
+    if (file.size() < DISK_FILE_HEADER_SIZE + size)
+        return std::nullopt;
+
+    // Strip the file header, as the DOS does before loading the data
+    file.erase(file.begin(), file.begin() + DISK_FILE_HEADER_SIZE);
+    file.resize(size);
+    return file;
+}
+
 static void AddBytes(std::vector<uint8_t>& data, uint8_t val, int count = 1)
 {
     if (count > 0)
@@ -49,6 +49,8 @@ public:
     void Eject() override;
     void Flush() override;
     void Reset() override;
+    bool CommitOverlay() override;
+    bool DiscardOverlay() override;
 
     std::string DiskPath() const override { return m_disk ? m_disk->GetPath() : ""; }
     std::string DiskFile() const override { return m_disk ? m_disk->GetFile() : ""; }
@@ -56,12 +58,15 @@ public:
     bool HasDisk() const override { return m_disk != nullptr; }
     bool IsLightOn() const override { return (m_regs.status & MOTOR_ON) != 0; }
 
+    std::optional<std::vector<uint8_t>> ReadFile(span<const uint8_t> type_name, size_t size) override;
+
 protected:
     std::pair<uint8_t, IDFIELD> GetSector(uint8_t index);
     std::optional<IDFIELD> FindSector();
-    std::pair<uint8_t, std::vector<uint8_t>> ReadSector();
-    uint8_t WriteSector(const std::vector<uint8_t>& data);
+    std::pair<uint8_t, span<const uint8_t>> ReadSector();
+    uint8_t WriteSector(span<const uint8_t> data);
     std::pair<uint8_t, IDFIELD> ReadAddress();
+    span<const uint8_t> ReadFileSector(uint8_t track, uint8_t sector);
     std::vector<uint8_t> ReadTrack();
     uint8_t VerifyTrack();
     uint8_t WriteTrack(const std::vector<uint8_t>& data);
@@ -84,4 +89,5 @@ protected:
 
     int m_state = 0;
     int m_motor_off_frames = 0;
+    int m_autosave_frames = 0;
 };
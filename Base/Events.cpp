@@ -10,6 +10,7 @@
 #include "CPU.h"
 #include "Mouse.h"
 #include "SAMIO.h"
+#include "Sound.h"
 
 CPU_EVENT events[MAX_EVENTS], * head_ptr, * free_head_ptr;
 
@@ -119,10 +120,6 @@ void ExecuteEvent(const CPU_EVENT& event)
         pMouse->Reset();
         break;
 
-    case EventType::BlueAlphaClock:
-        pSampler->Clock(event.due_time);
-        break;
-
     case EventType::TapeEdge:
         Tape::NextEdge(event.due_time);
         break;
@@ -136,6 +133,11 @@ void ExecuteEvent(const CPU_EVENT& event)
         AddEvent(EventType::InputUpdate, event.due_time + CPU_CYCLES_PER_FRAME);
         break;
 
+    case EventType::SoundUpdate:
+        Sound::RenderAhead();
+        AddEvent(EventType::SoundUpdate, event.due_time + CPU_CYCLES_PER_FRAME / 4);
+        break;
+
     case EventType::None:
         break;
     }
@@ -11,8 +11,8 @@ enum class EventType
     FrameInterrupt, FrameInterruptEnd,
     LineInterrupt, LineInterruptEnd,
     MidiOutStart, MidiOutEnd, MidiTxfmstEnd,
-    MouseReset, BlueAlphaClock, TapeEdge,
-    AsicReady, InputUpdate
+    MouseReset, TapeEdge,
+    AsicReady, InputUpdate, SoundUpdate
 };
 
 struct CPU_EVENT
@@ -26,6 +26,7 @@
 #include "AVI.h"
 #include "Debug.h"
 #include "Drive.h"
+#include "FrameLog.h"
 #include "GIF.h"
 #include "GUI.h"
 #include "Keyin.h"
@@ -270,6 +271,7 @@ void End()
 
         GIF::AddFrame(*pFrameBuffer);
         AVI::AddFrame(*pFrameBuffer);
+        FrameLog::AddVideo(*pFrameBuffer);
 
         DrawOSD(*pFrameBuffer);
     }
@@ -315,7 +317,12 @@ void Sync()
     using namespace std::literals::chrono_literals;
     auto now = high_resolution_clock::now();
 
-    if ((g_nTurbo & TURBO_BOOT) && !GUI::IsActive())
+    if (FrameLog::IsActive())
+    {
+        // Every frame must be drawn for its hash to be valid
+        draw_frame = true;
+    }
+    else if ((g_nTurbo & TURBO_BOOT) && !GUI::IsActive())
     {
         draw_frame = false;
     }
@@ -342,6 +349,9 @@ void Sync()
             auto fps = 1s / ((now - *last_profiled) / static_cast<float>(num_frames));
             auto percent = fps / ACTUAL_FRAMES_PER_SECOND * 100;
             profile_text = fmt::format("{:.0f}%", percent);
+
+            if (GetOption(soundstats) && !Sound::GetStatsText().empty())
+                profile_text += " " + Sound::GetStatsText();
         }
 
         last_profiled = now;
@@ -350,8 +360,8 @@ void Sync()
 
     if (GUI::IsActive())
     {
-        static uint8_t abSilence[SAMPLE_FREQ * BYTES_PER_SAMPLE / EMULATED_FRAMES_PER_SECOND];
-        Audio::AddData(abSilence, sizeof(abSilence));
+        static std::vector<uint8_t> silence(Sound::SamplesPerFrame() * BYTES_PER_SAMPLE);
+        Audio::AddData(silence.data(), static_cast<int>(silence.size()));
     }
 }
 
@@ -0,0 +1,118 @@
+// Part of SimCoupe - A SAM Coupe emulator
+//
+// FrameLog.cpp: Per-frame video/audio hash log for regression testing
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+// Notes:
+//  Each emulated frame produces one line holding the frame number, XXH64
+//  hashes of the rendered display and mixed audio, and the main Z80
+//  registers. With -framelog the lines are written to a file, and with
+//  -frameverify they're compared against a previously written log. The
+//  first mismatch is a fatal error, and reaching the end of the reference
+//  log quits cleanly.
+
+#include "SimCoupe.h"
+#include "FrameLog.h"
+
+#include "CPU.h"
+#include "Options.h"
+
+namespace FrameLog
+{
+
+static unique_FILE log_file;
+static std::ifstream verify_file;
+static uint64_t frame_number;
+static uint64_t video_hash;
+
+bool Init()
+{
+    Exit();
+
+    frame_number = 0;
+    video_hash = 0;
+
+    if (!GetOption(framelog).empty())
+    {
+        log_file = fopen(GetOption(framelog).c_str(), "w");
+        if (!log_file)
+            Message(MsgType::Fatal, "Failed to create frame log:\n\n{}", GetOption(framelog));
+    }
+
+    if (!GetOption(frameverify).empty())
+    {
+        verify_file.open(GetOption(frameverify));
+        if (!verify_file)
+            Message(MsgType::Fatal, "Failed to open frame log:\n\n{}", GetOption(frameverify));
+    }
+
+    return true;
+}
+
+void Exit()
+{
+    log_file.reset();
+    verify_file.close();
+}
+
+bool IsActive()
+{
+    return log_file || verify_file.is_open();
+}
+
+
+void AddVideo(const FrameBuffer& fb)
+{
+    if (!IsActive())
+        return;
+
+    video_hash = HashBlock(fb.GetLine(0), static_cast<size_t>(fb.Width()) * fb.Height());
+}
+
+void AddAudio(const uint8_t* pb, int len)
+{
+    if (!IsActive())
+        return;
+
+    // The audio is the last thing generated for a frame, so this completes the entry
+    auto line = fmt::format("{} {:016x} {:016x} af={:04x} bc={:04x} de={:04x} hl={:04x} ix={:04x} iy={:04x} sp={:04x} pc={:04x}",
+        frame_number++, video_hash, HashBlock(pb, len),
+        cpu.get_af(), cpu.get_bc(), cpu.get_de(), cpu.get_hl(),
+        cpu.get_ix(), cpu.get_iy(), cpu.get_sp(), cpu.get_pc());
+
+    if (log_file)
+        fmt::print(log_file, "{}\n", line);
+
+    if (verify_file.is_open())
+    {
+        std::string expected;
+        if (!std::getline(verify_file, expected))
+        {
+            TRACE("Frame log verified {} frames\n", frame_number - 1);
+            verify_file.close();
+            g_fQuit = true;
+            return;
+        }
+
+        if (!expected.empty() && expected.back() == '\r')
+            expected.pop_back();
+
+        if (line != expected)
+            Message(MsgType::Fatal, "Frame log mismatch at frame {}:\n\nexpected: {}\nactual:   {}", frame_number - 1, expected, line);
+    }
+}
+
+} // namespace FrameLog
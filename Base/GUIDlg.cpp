@@ -329,6 +329,7 @@ HDDProperties::HDDProperties(EditControl* pEdit_, Window* pParent_, const char*
 
     new TextControl(this, 12, 37, "Size (MB):");
     m_pSize = new NumberEditControl(this, 68, 34, 30);
+    m_pAllocated = new TextControl(this, 106, 37, "", GREY_7);
 
     m_pOK = new TextButton(this, m_nWidth - 117, m_nHeight - 21, "OK", 50);
     m_pCancel = new TextButton(this, m_nWidth - 62, m_nHeight - 21, "Cancel", 50);
@@ -364,6 +365,9 @@ void HDDProperties::OnNotify(Window* pWindow_, int /*nParam_*/)
             m_pSize->SetText(fmt::format("{}", (pGeom->uTotalSectors + (1 << 11) - 1) >> 11));
         }
 
+        // Sparse images may use much less storage than their size
+        m_pAllocated->SetText(disk ? fmt::format("({}MB allocated)", (disk->AllocatedSize() + (1 << 20) - 1) >> 20) : "");
+
         // The geometry is read-only for existing images
         m_pSize->Enable(!disk);
 
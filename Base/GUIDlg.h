@@ -109,6 +109,7 @@ protected:
     EditControl* m_pEdit = nullptr;
     EditControl* m_pFile = nullptr;
     EditControl* m_pSize = nullptr;
+    TextControl* m_pAllocated = nullptr;
     TextButton* m_pBrowse = nullptr;
     TextButton* m_pCreate = nullptr;
     TextButton* m_pOK = nullptr;
@@ -25,6 +25,11 @@
 
 #include "HardDisk.h"
 #include "IDEDisk.h"
+#include "Options.h"
+
+#ifdef _WIN32
+#include <io.h>
+#endif
 
 
 HardDisk::HardDisk(const std::string& disk_path) :
@@ -119,6 +124,87 @@ HDFHardDisk::HDFHardDisk(const std::string& disk_path)
     return nullptr;
 }
 
+// Positional reads and writes, leaving the file position untouched
+static bool ReadFileData(FILE* file, uint64_t offset, uint8_t* pb_, size_t len)
+{
+    if (!file)
+        return false;
+
+#ifdef _WIN32
+    OVERLAPPED ov{};
+    ov.Offset = static_cast<DWORD>(offset);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    DWORD dwRead = 0;
+    auto hfile = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)));
+    return ReadFile(hfile, pb_, static_cast<DWORD>(len), &dwRead, &ov) && dwRead == len;
+#else
+    return pread(fileno(file), pb_, len, static_cast<off_t>(offset)) == static_cast<ssize_t>(len);
+#endif
+}
+
+static bool WriteFileData(FILE* file, uint64_t offset, const uint8_t* pb_, size_t len)
+{
+    if (!file)
+        return false;
+
+#ifdef _WIN32
+    OVERLAPPED ov{};
+    ov.Offset = static_cast<DWORD>(offset);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    DWORD dwWritten = 0;
+    auto hfile = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)));
+    return WriteFile(hfile, pb_, static_cast<DWORD>(len), &dwWritten, &ov) && dwWritten == len;
+#else
+    return pwrite(fileno(file), pb_, len, static_cast<off_t>(offset)) == static_cast<ssize_t>(len);
+#endif
+}
+
+// Extend a file to the given size, without allocating storage for the new space
+static bool ExtendSparse(FILE* file, uint64_t size)
+{
+#ifdef _WIN32
+    // Best effort, as not all filesystems support sparse files
+    DWORD dwRet = 0;
+    auto hfile = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)));
+    DeviceIoControl(hfile, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &dwRet, nullptr);
+
+    return _chsize_s(_fileno(file), static_cast<__int64>(size)) == 0;
+#else
+    return ftruncate(fileno(file), static_cast<off_t>(size)) == 0;
+#endif
+}
+
+// Release the storage of any filesystem blocks left entirely zero by a write
+static void PunchZeroBlocks(FILE* file, uint64_t offset, size_t len)
+{
+    std::array<uint8_t, HDF_TRIM_BLOCK> block;
+    auto start = offset / HDF_TRIM_BLOCK * HDF_TRIM_BLOCK;
+
+    for (auto pos = start; pos < offset + len; pos += HDF_TRIM_BLOCK)
+    {
+        if (!ReadFileData(file, pos, block.data(), block.size()) ||
+            std::any_of(block.begin(), block.end(), [](uint8_t b) { return b != 0; }))
+        {
+            continue;
+        }
+
+#if defined(_WIN32)
+        FILE_ZERO_DATA_INFORMATION zero{};
+        zero.FileOffset.QuadPart = static_cast<LONGLONG>(pos);
+        zero.BeyondFinalZero.QuadPart = static_cast<LONGLONG>(pos + HDF_TRIM_BLOCK);
+
+        DWORD dwRet = 0;
+        auto hfile = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)));
+        DeviceIoControl(hfile, FSCTL_SET_ZERO_DATA, &zero, sizeof(zero), nullptr, 0, &dwRet, nullptr);
+#elif defined(FALLOC_FL_PUNCH_HOLE)
+        fallocate(fileno(file), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+            static_cast<off_t>(pos), HDF_TRIM_BLOCK);
+#endif
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /*static*/ bool HDFHardDisk::Create(const std::string& disk_path, unsigned int uTotalSectors_)
@@ -151,14 +237,13 @@ bool HDFHardDisk::Create(unsigned int uTotalSectors_)
         SetIdentifyData(nullptr);
 
         // Calculate the total disk data size
-        off_t lDataSize = uTotalSectors_ * 512;
-        uint8_t bNull = 0;
+        auto data_size = static_cast<uint64_t>(uTotalSectors_) * 512;
 
-        // Write the header, and extend the file up to the full size
+        // Write the header, and extend the file up to the full size as a sparse file
         ret = fwrite(&sHeader, sizeof(sHeader), 1, file) &&
             fwrite(&m_sIdentify, sizeof(m_sIdentify), 1, file) &&
-            !fseek(file, lDataSize - sizeof(bNull), SEEK_CUR) &&
-            fwrite(&bNull, sizeof(bNull), 1, file);
+            !fflush(file) &&
+            ExtendSparse(file, uDataOffset + data_size);
 
         file.reset();
 
@@ -181,8 +266,20 @@ bool HDFHardDisk::Open(bool read_only)
     if (m_strPath.empty())
         return false;
 
+    // In overlay mode the image is only read, with writes going to a temporary file
+    bool overlay = GetOption(diskoverlay) && !read_only;
+
     // Open read-write, falling back on read-only (not ideal!)
-    if ((!read_only && (m_file = fopen(m_strPath.c_str(), "r+b"))) || (m_file = fopen(m_strPath.c_str(), "rb")))
+    if (!read_only && !overlay)
+        m_file = fopen(m_strPath.c_str(), "r+b");
+
+    if (!m_file)
+    {
+        m_file = fopen(m_strPath.c_str(), "rb");
+        read_only = true;
+    }
+
+    if (m_file)
     {
         RS_IDE sHeader;
 
@@ -212,12 +309,34 @@ bool HDFHardDisk::Open(bool read_only)
             else if (fstat(fileno(m_file), &st) == 0)
             {
                 m_sGeometry.uTotalSectors = static_cast<unsigned int>((st.st_size - m_uDataOffset) / m_uSectorSize);
+                TRACE("HDF size {}K, allocated {}K\n", st.st_size / 1024, AllocatedSize() / 1024);
 
                 // Update the identify data
                 SetIdentifyData(&m_sIdentify);
             }
 
-            return true;
+            // Read-only images are mapped, with writable images using a sector cache
+            if (read_only)
+                m_mapped = MappedFile::Open(m_strPath);
+
+            if (!m_mapped)
+                CacheReset();
+
+            if (!overlay)
+                return true;
+
+            // Sectors are only written to the overlay file as needed, leaving holes elsewhere
+            std::error_code ec;
+            auto temp_dir = fs::temp_directory_path(ec);
+            m_overlay_path = (temp_dir / fmt::format("simcoupe-{:08x}.overlay", std::random_device{}())).string();
+
+            if (!ec && (m_overlay_file = fopen(m_overlay_path.c_str(), "w+b")))
+            {
+                m_overlay_sectors.assign(m_sGeometry.uTotalSectors, false);
+                return true;
+            }
+
+            TRACE("Failed to create HDF overlay file: {}\n", m_overlay_path);
         }
     }
 
@@ -227,17 +346,234 @@ bool HDFHardDisk::Open(bool read_only)
 
 void HDFHardDisk::Close()
 {
+    m_mapped.reset();
     m_file.reset();
+
+    m_cache_entries.clear();
+    m_cache_data.clear();
+    m_cache_index.clear();
+
+    if (m_overlay_file)
+    {
+        m_overlay_file.reset();
+
+        std::error_code ec;
+        fs::remove(m_overlay_path, ec);
+    }
+
+    m_overlay_sectors.clear();
+}
+
+uint64_t HDFHardDisk::AllocatedSize() const
+{
+#ifdef _WIN32
+    DWORD dwHigh = 0;
+    auto dwLow = GetCompressedFileSizeA(m_strPath.c_str(), &dwHigh);
+    if (dwLow == INVALID_FILE_SIZE && GetLastError() != NO_ERROR)
+        return 0;
+
+    return (static_cast<uint64_t>(dwHigh) << 32) | dwLow;
+#else
+    struct stat st {};
+    return stat(m_strPath.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_blocks) * 512 : 0;
+#endif
+}
+
+bool HDFHardDisk::CommitOverlay()
+{
+    if (!m_overlay_file)
+        return true;
+
+    unique_FILE file = fopen(m_strPath.c_str(), "r+b");
+    if (!file)
+        return false;
+
+    std::vector<uint8_t> data(m_uSectorSize);
+    for (unsigned int uSector = 0; uSector < m_overlay_sectors.size(); ++uSector)
+    {
+        if (!m_overlay_sectors[uSector])
+            continue;
+
+        auto offset = static_cast<uint64_t>(uSector) * m_uSectorSize;
+        if (!ReadFileData(m_overlay_file, offset, data.data(), data.size()) ||
+            !WriteFileData(file, m_uDataOffset + offset, data.data(), data.size()))
+        {
+            return false;
+        }
+
+        m_overlay_sectors[uSector] = false;
+    }
+
+    file.reset();
+
+    // Refresh the mapping to be sure it sees the committed data
+    if (m_mapped)
+        m_mapped = MappedFile::Open(m_strPath);
+
+    return DiscardOverlay();
+}
+
+bool HDFHardDisk::DiscardOverlay()
+{
+    if (!m_overlay_file)
+        return true;
+
+    std::fill(m_overlay_sectors.begin(), m_overlay_sectors.end(), false);
+
+    // The cache may hold overlay data
+    if (!m_cache_entries.empty())
+        CacheReset();
+
+    std::error_code ec;
+    fs::resize_file(m_overlay_path, 0, ec);
+    return !ec;
 }
 
 bool HDFHardDisk::ReadSector(unsigned int uSector_, uint8_t* pb_)
 {
-    off_t lOffset = m_uDataOffset + static_cast<off_t>(uSector_)* m_uSectorSize;
-    return m_file && !fseek(m_file, lOffset, SEEK_SET) && (fread(pb_, 1, m_uSectorSize, m_file) == m_uSectorSize);
+    auto offset = m_uDataOffset + static_cast<uint64_t>(uSector_) * m_uSectorSize;
+
+    if (uSector_ < m_overlay_sectors.size() && m_overlay_sectors[uSector_])
+        return ReadFileData(m_overlay_file, static_cast<uint64_t>(uSector_) * m_uSectorSize, pb_, m_uSectorSize);
+
+    if (m_mapped)
+    {
+        auto data = m_mapped->Data();
+        if (offset + m_uSectorSize > data.size())
+            return false;
+
+        memcpy(pb_, data.data() + offset, m_uSectorSize);
+        return true;
+    }
+
+    if (auto pbCached = CacheSlot(uSector_, false))
+    {
+        memcpy(pb_, pbCached, m_uSectorSize);
+        return true;
+    }
+
+    if (!ReadFileData(m_file, offset, pb_, m_uSectorSize))
+        return false;
+
+    if (auto pbCached = CacheSlot(uSector_, true))
+        memcpy(pbCached, pb_, m_uSectorSize);
+
+    return true;
 }
 
 bool HDFHardDisk::WriteSector(unsigned int uSector_, uint8_t* pb_)
 {
-    off_t lOffset = m_uDataOffset + static_cast<off_t>(uSector_)* m_uSectorSize;
-    return m_file && !fseek(m_file, lOffset, SEEK_SET) && (fwrite(pb_, 1, m_uSectorSize, m_file) == m_uSectorSize);
+    auto offset = m_uDataOffset + static_cast<uint64_t>(uSector_) * m_uSectorSize;
+
+    if (m_overlay_file)
+    {
+        if (uSector_ >= m_overlay_sectors.size() ||
+            !WriteFileData(m_overlay_file, static_cast<uint64_t>(uSector_) * m_uSectorSize, pb_, m_uSectorSize))
+        {
+            return false;
+        }
+
+        m_overlay_sectors[uSector_] = true;
+    }
+    else if (!WriteFileData(m_file, offset, pb_, m_uSectorSize))
+        return false;
+    else if (std::all_of(pb_, pb_ + m_uSectorSize, [](uint8_t b) { return b == 0; }))
+        PunchZeroBlocks(m_file, offset, m_uSectorSize);
+
+    // The cache is write-through, so only existing entries need updating
+    if (auto pbCached = CacheSlot(uSector_, false))
+        memcpy(pbCached, pb_, m_uSectorSize);
+
+    return true;
+}
+
+void HDFHardDisk::ReadAhead(unsigned int uSector_, unsigned int uCount_)
+{
+    // Commands reading one sector at a time (as BDOS does) are read ahead if sequential
+    auto sequential = uSector_ == m_uNextRead;
+    m_uNextRead = uSector_ + 1;
+    if (sequential)
+        uCount_ = std::max(uCount_, HDF_READ_AHEAD_SEQ);
+
+    // Nothing to do for mapped images, or if the next sector was already read ahead
+    if (m_cache_entries.empty() || uSector_ >= m_sGeometry.uTotalSectors || m_cache_index.count(uSector_))
+        return;
+
+    // Read the sectors the command still needs, up to the first we already hold
+    auto uMax = std::min({ uCount_, HDF_READ_AHEAD_MAX, m_sGeometry.uTotalSectors - uSector_ });
+    unsigned int uLen = 1;
+    while (uLen < uMax && !m_cache_index.count(uSector_ + uLen))
+        uLen++;
+
+    // Single sectors are left for ReadSector
+    if (uLen < 2)
+        return;
+
+    std::vector<uint8_t> data(uLen * m_uSectorSize);
+    if (ReadFileData(m_file, m_uDataOffset + static_cast<uint64_t>(uSector_) * m_uSectorSize, data.data(), data.size()))
+    {
+        for (unsigned int i = 0; i < uLen; ++i)
+            memcpy(CacheSlot(uSector_ + i, true), data.data() + i * m_uSectorSize, m_uSectorSize);
+    }
+}
+
+void HDFHardDisk::CacheReset()
+{
+    m_cache_entries.resize(HDF_CACHE_SECTORS);
+    for (size_t i = 0; i < m_cache_entries.size(); ++i)
+        m_cache_entries[i] = { UINT_MAX, i - 1, i + 1 };
+
+    m_cache_mru = 0;
+    m_cache_lru = m_cache_entries.size() - 1;
+    m_cache_data.resize(HDF_CACHE_SECTORS * m_uSectorSize);
+    m_cache_index.clear();
+}
+
+// Find the cache data for a sector, optionally replacing the least recently used entry
+uint8_t* HDFHardDisk::CacheSlot(unsigned int uSector_, bool fAllocate_)
+{
+    if (m_cache_entries.empty())
+        return nullptr;
+
+    size_t index;
+    if (auto it = m_cache_index.find(uSector_); it != m_cache_index.end())
+        index = it->second;
+    else if (!fAllocate_)
+        return nullptr;
+    else
+    {
+        index = m_cache_lru;
+        auto& entry = m_cache_entries[index];
+
+        m_cache_index.erase(entry.sector);
+        m_cache_index[uSector_] = index;
+        entry.sector = uSector_;
+    }
+
+    // Move to the front of the use order
+    if (index != m_cache_mru)
+    {
+        CacheUnlink(index);
+        m_cache_entries[index].prev = SIZE_MAX;
+        m_cache_entries[index].next = m_cache_mru;
+        m_cache_entries[m_cache_mru].prev = index;
+        m_cache_mru = index;
+    }
+
+    return m_cache_data.data() + index * m_uSectorSize;
+}
+
+void HDFHardDisk::CacheUnlink(size_t index)
+{
+    auto& entry = m_cache_entries[index];
+
+    if (index == m_cache_lru)
+        m_cache_lru = entry.prev;
+    else
+        m_cache_entries[entry.next].prev = entry.prev;
+
+    if (index == m_cache_mru)
+        m_cache_mru = entry.next;
+    else
+        m_cache_entries[entry.prev].next = entry.next;
 }
@@ -22,8 +22,13 @@
 
 #include "SAMIO.h"
 #include "ATA.h"
+#include "Stream.h"
 
 const unsigned int HDD_ACTIVE_FRAMES = 2;    // Frames the HDD is considered active after a command
+const unsigned int HDF_CACHE_SECTORS = 256;  // Sectors held in the HDF sector cache
+const unsigned int HDF_READ_AHEAD_MAX = 64;  // Maximum sectors read ahead in one request
+const unsigned int HDF_READ_AHEAD_SEQ = 16;  // Sectors read ahead when single sector reads are sequential
+const unsigned int HDF_TRIM_BLOCK = 4096;    // Filesystem block size for releasing zeroed storage
 
 
 class HardDisk : public ATADevice
@@ -35,6 +40,9 @@ public:
 public:
     static std::unique_ptr<HardDisk> OpenObject(const std::string& disk_path, bool read_only = false);
     virtual bool Open(bool read_only = false) = 0;
+    virtual bool CommitOverlay() { return true; }
+    virtual bool DiscardOverlay() { return true; }
+    virtual uint64_t AllocatedSize() const { return static_cast<uint64_t>(m_sGeometry.uTotalSectors) * 512; }
 
 public:
     bool IsSDIDEDisk();
@@ -49,6 +57,7 @@ class HDFHardDisk final : public HardDisk
 {
 public:
     HDFHardDisk(const std::string& disk_path);
+    ~HDFHardDisk() { Close(); }
 
 public:
     static bool Create(const std::string& disk_path, unsigned int uTotalSectors_);
@@ -61,9 +70,31 @@ public:
 
     bool ReadSector(unsigned int uSector_, uint8_t* pb_) override;
     bool WriteSector(unsigned int uSector_, uint8_t* pb_) override;
+    void ReadAhead(unsigned int uSector_, unsigned int uCount_) override;
+    bool CommitOverlay() override;
+    bool DiscardOverlay() override;
+    uint64_t AllocatedSize() const override;
 
 protected:
+    void CacheReset();
+    uint8_t* CacheSlot(unsigned int uSector_, bool fAllocate_);
+    void CacheUnlink(size_t index);
+
     unique_FILE m_file;
+    std::unique_ptr<MappedFile> m_mapped;   // read-only images are mapped instead of cached
     unsigned int m_uDataOffset = 0;
     unsigned int m_uSectorSize = 0;
+
+    // LRU cache of recently used sectors for writable images, with entries linked in use order
+    struct CacheEntry { unsigned int sector; size_t prev, next; };
+    std::vector<CacheEntry> m_cache_entries;
+    std::vector<uint8_t> m_cache_data;
+    std::map<unsigned int, size_t> m_cache_index;
+    size_t m_cache_mru = 0, m_cache_lru = 0;
+    unsigned int m_uNextRead = UINT_MAX;    // sector following the last read, to detect sequential access
+
+    // Sparse per-session file holding sectors written in overlay mode, at their image positions
+    std::string m_overlay_path;
+    unique_FILE m_overlay_file;
+    std::vector<bool> m_overlay_sectors;
 };
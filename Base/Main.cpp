@@ -21,12 +21,18 @@
 #include "SimCoupe.h"
 #include "Main.h"
 
+#include "AtomLite.h"
 #include "CPU.h"
+#include "Disk.h"
 #include "Frame.h"
+#include "FrameLog.h"
 #include "GUI.h"
 #include "Input.h"
 #include "Options.h"
+#include "Resampler.h"
+#include "SID.h"
 #include "Sound.h"
+#include "Tape.h"
 #include "UI.h"
 #include "Video.h"
 
@@ -44,6 +50,30 @@ extern "C" int main(int argc_, char* argv_[])
 namespace Main
 {
 
+// Developer benchmarks and checks, selected by the bench option as name[:path]
+static const std::map<std::string, std::function<std::string(const std::string&)>> benchmarks
+{
+    { "sid", [](const std::string& path) { return SIDDevice::Benchmark(path); } },
+    { "disk", [](const std::string& path) { return Disk::Benchmark(path); } },
+    { "hdf", [](const std::string& path) { return AtomLiteDevice::Benchmark(path); } },
+    { "dac", [](const std::string&) { return DAC::Benchmark(); } },
+    { "pitch", [](const std::string&) { return Sound::PitchCheck(); } },
+    { "resample", [](const std::string&) { return Resampler::Benchmark(); } },
+    { "tapeedge", [](const std::string& path) { return Tape::EdgeLoopCheck(path); } },
+};
+
+static void RunBenchmark(const std::string& bench)
+{
+    auto sep = bench.find(':');
+    auto name = bench.substr(0, sep);
+    auto path = (sep != std::string::npos) ? bench.substr(sep + 1) : std::string();
+
+    auto it = benchmarks.find(name);
+    auto report = (it != benchmarks.end()) ? it->second(path) : fmt::format("Unknown benchmark: {}", name);
+    fmt::print("{}\n", report);
+    Message(MsgType::Info, report);
+}
+
 bool Init(int argc_, char* argv_[])
 {
     if (libspectrum_init() != LIBSPECTRUM_ERROR_NONE)
@@ -52,13 +82,24 @@ bool Init(int argc_, char* argv_[])
     if (!Options::Load(argc_, argv_))
         return false;
 
-    return OSD::Init() && Frame::Init() && CPU::Init(true) && UI::Init() && Sound::Init() && Input::Init() && Video::Init();
+    if (!(OSD::Init() && Frame::Init() && CPU::Init(true) && UI::Init() && Sound::Init() && Input::Init() && Video::Init() && FrameLog::Init()))
+        return false;
+
+    if (!GetOption(bench).empty())
+    {
+        RunBenchmark(GetOption(bench));
+        return false;
+    }
+
+    return true;
 }
 
 void Exit()
 {
     GUI::Stop();
 
+    FrameLog::Exit();
+
     Video::Exit();
     Input::Exit();
     Sound::Exit();
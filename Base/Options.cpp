@@ -106,11 +106,17 @@ auto set_named_value(const std::string& option_name, const std::string& str) ->
     else if (name == "drive2") { set_value(g_config.drive2, str); }
     else if (name == "turbodisk") { set_value(g_config.turbodisk, str); }
     else if (name == "dosboot") { set_value(g_config.dosboot, str); }
+    else if (name == "disktraps") { set_value(g_config.disktraps, str); }
+    else if (name == "diskautosave") { set_value(g_config.diskautosave, str); }
+    else if (name == "disksync") { set_value(g_config.disksync, str); }
+    else if (name == "diskcache") { set_value(g_config.diskcache, str); }
+    else if (name == "diskoverlay") { set_value(g_config.diskoverlay, str); }
     else if (name == "dosdisk") { set_value(g_config.dosdisk, str); }
     else if (name == "stdfloppy") { set_value(g_config.stdfloppy, str); }
     else if (name == "nextfile") { set_value(g_config.nextfile, str); }
     else if (name == "turbotape") { set_value(g_config.turbotape, str); }
     else if (name == "tapetraps") { set_value(g_config.tapetraps, str); }
+    else if (name == "tapeedgeloops") { set_value(g_config.tapeedgeloops, str); }
     else if (name == "disk1") { set_value(g_config.disk1, str); }
     else if (name == "disk2") { set_value(g_config.disk2, str); }
     else if (name == "atomdiskleft0") { set_value(g_config.atomdiskleft0, str); }
@@ -159,17 +165,30 @@ auto set_named_value(const std::string& option_name, const std::string& str) ->
     else if (name == "audiosync") { set_value(g_config.audiosync, str); }
     else if (name == "saahighpass") { set_value(g_config.saahighpass, str); }
     else if (name == "latency") { set_value(g_config.latency, str); }
+    else if (name == "samplerate") { set_value(g_config.samplerate, str); }
     else if (name == "dac7c") { set_value(g_config.dac7c, str); }
     else if (name == "samplerfreq") { set_value(g_config.samplerfreq, str); }
+    else if (name == "dacquality") { set_value(g_config.dacquality, str); }
+    else if (name == "dachighpass") { set_value(g_config.dachighpass, str); }
+    else if (name == "daclowpass") { set_value(g_config.daclowpass, str); }
     else if (name == "voicebox") { set_value(g_config.voicebox, str); }
     else if (name == "sid") { set_value(g_config.sid, str); }
+    else if (name == "sidsampling") { set_value(g_config.sidsampling, str); }
+    else if (name == "mixer") { set_value(g_config.mixer, str); }
+    else if (name == "soundthread") { set_value(g_config.soundthread, str); }
     else if (name == "drivelights") { set_value(g_config.drivelights, str); }
     else if (name == "profile") { set_value(g_config.profile, str); }
+    else if (name == "soundstats") { set_value(g_config.soundstats, str); }
     else if (name == "status") { set_value(g_config.status, str); }
     else if (name == "breakonexec") { set_value(g_config.breakonexec, str); }
     else if (name == "fkeys") { set_value(g_config.fkeys, str); }
     else if (name == "rasterdebug") { set_value(g_config.rasterdebug, str); }
     else if (name == "exitonhalt") { set_value(g_config.exitonhalt, str); }
+    else if (name == "framelog") { set_value(g_config.framelog, str); }
+    else if (name == "frameverify") { set_value(g_config.frameverify, str); }
+    else if (name == "siddump") { set_value(g_config.siddump, str); }
+    else if (name == "soundlog") { set_value(g_config.soundlog, str); }
+    else if (name == "bench") { set_value(g_config.bench, str); }
     else
     {
         return false;
@@ -296,11 +315,17 @@ auto Save() -> bool
         write_option(ofs, "drive2", g_config.drive2, defaults.drive2);
         write_option(ofs, "turbodisk", g_config.turbodisk, defaults.turbodisk);
         write_option(ofs, "dosboot", g_config.dosboot, defaults.dosboot);
+        write_option(ofs, "disktraps", g_config.disktraps, defaults.disktraps);
+        write_option(ofs, "diskautosave", g_config.diskautosave, defaults.diskautosave);
+        write_option(ofs, "disksync", g_config.disksync, defaults.disksync);
+        write_option(ofs, "diskcache", g_config.diskcache, defaults.diskcache);
+        write_option(ofs, "diskoverlay", g_config.diskoverlay, defaults.diskoverlay);
         write_option(ofs, "dosdisk", g_config.dosdisk, defaults.dosdisk);
         write_option(ofs, "stdfloppy", g_config.stdfloppy, defaults.stdfloppy);
         write_option(ofs, "nextfile", g_config.nextfile, defaults.nextfile);
         write_option(ofs, "turbotape", g_config.turbotape, defaults.turbotape);
         write_option(ofs, "tapetraps", g_config.tapetraps, defaults.tapetraps);
+        write_option(ofs, "tapeedgeloops", g_config.tapeedgeloops, defaults.tapeedgeloops);
         write_option(ofs, "disk1", g_config.disk1, defaults.disk1);
         write_option(ofs, "disk2", g_config.disk2, defaults.disk2);
         write_option(ofs, "atomdiskleft0", g_config.atomdiskleft0, defaults.atomdiskleft0);
@@ -347,12 +372,20 @@ auto Save() -> bool
         write_option(ofs, "audiosync", g_config.audiosync, defaults.audiosync);
         write_option(ofs, "saahighpass", g_config.saahighpass, defaults.saahighpass);
         write_option(ofs, "latency", g_config.latency, defaults.latency);
+        write_option(ofs, "samplerate", g_config.samplerate, defaults.samplerate);
         write_option(ofs, "dac7c", g_config.dac7c, defaults.dac7c);
         write_option(ofs, "samplerfreq", g_config.samplerfreq, defaults.samplerfreq);
+        write_option(ofs, "dacquality", g_config.dacquality, defaults.dacquality);
+        write_option(ofs, "dachighpass", g_config.dachighpass, defaults.dachighpass);
+        write_option(ofs, "daclowpass", g_config.daclowpass, defaults.daclowpass);
         write_option(ofs, "voicebox", g_config.voicebox, defaults.voicebox);
         write_option(ofs, "sid", g_config.sid, defaults.sid);
+        write_option(ofs, "sidsampling", g_config.sidsampling, defaults.sidsampling);
+        write_option(ofs, "mixer", g_config.mixer, defaults.mixer);
+        write_option(ofs, "soundthread", g_config.soundthread, defaults.soundthread);
         write_option(ofs, "drivelights", g_config.drivelights, defaults.drivelights);
         write_option(ofs, "profile", g_config.profile, defaults.profile);
+        write_option(ofs, "soundstats", g_config.soundstats, defaults.soundstats);
         write_option(ofs, "status", g_config.status, defaults.status);
         write_option(ofs, "breakonexec", g_config.breakonexec, defaults.breakonexec);
         write_option(ofs, "fkeys", g_config.fkeys, defaults.fkeys);
@@ -57,12 +57,18 @@ struct Config
     int drive2 = 1;                     // Drive 2 type
     bool turbodisk = true;              // Run at turbo speed during disk access?
     bool dosboot = true;                // Automagically boot DOS from non-bootable disks?
+    bool disktraps = false;             // Instant loading of DOS files, bypassing the floppy controller?
     std::string dosdisk;                // Custom DOS boot disk path (blank for built-in SAMDOS 2.2)
     bool stdfloppy = true;              // Assume real disks are standard format, initially?
+    int diskautosave = 10;              // Seconds between background saves of modified disk images (0=off)
+    int disksync = 1;                   // Flush saved disk images to storage (0=never, 1=on close, 2=every save)
+    std::string diskcache;              // Directory caching decompressed disk images (blank=off)
+    bool diskoverlay = false;           // Keep disk writes in a session overlay, leaving images unchanged?
     int nextfile = 0;                   // Next file number for auto-generated filenames
 
     bool turbotape = true;              // Run at turn speed during tape loading?
     bool tapetraps = true;              // Instant loading of ROM tape blocks?
+    bool tapeedgeloops = false;         // Skip custom loader edge loop passes? (experimental)
 
     std::string disk1;                  // Floppy disk image in drive 1
     std::string disk2;                  // Floppy disk image in drive 2
@@ -119,19 +125,32 @@ struct Config
     bool audiosync = false;             // Forced audio sync? (seamless but jittery)
     bool saahighpass = true;            // Enable high-pass filter for SAA 1099
     int latency = 3;                    // Amount of sound buffering
+    int samplerate = 44100;             // Output sample rate in Hz (44100, 48000 or 96000), applied on restart
     int dac7c = 1;                      // DAC device on shared port &7c? (0=none, 1=BlueAlpha Sampler, 2=SAMVox, 3=Paula)
     int samplerfreq = 18000;            // Blue Alpha Sampler clock frequency (default=18KHz)
+    int dacquality = 1;                 // DAC and beeper synthesis quality (0=fast, 1=normal, 2=high)
+    int dachighpass = 16;               // DAC and beeper DC-blocking high-pass frequency in Hz (0=off)
+    int daclowpass = 0;                 // DAC and beeper low-pass roll-off frequency in Hz (0=default gentle roll-off)
     bool voicebox = true;               // Blue Alpha VoiceBox connected?
     int sid = 1;                        // SID chip type (0=none, 1=MOS6581, 2=MOS8580)
+    int sidsampling = 0;                // reSID sampling method (0=fast, 1=interpolate, 2=resample, 3=resample fast)
+    std::string mixer;                  // Per-device mix settings, as name=gain[/pan],... (dac,saa,sid,voicebox,beeper)
+    bool soundthread = true;            // Synthesise SAA/SID output on worker threads?
 
     int drivelights = 1;                // Show floppy drive LEDs (0=none, 1=top-left, 2=bottom-left)
     bool profile = true;                // Show current emulation speed?
     bool status = true;                 // Show status messages?
+    bool soundstats = false;            // Show audio pipeline stats with the profile text?
 
     bool breakonexec = false;           // Break on code auto-execute?
     bool rasterdebug = true;            // Raster-accurate debugger display
 
     bool exitonhalt = false;            // Quit when Z80 executes DI;HALT? (batch mode; not saved, same as autoboot)
+    std::string framelog;               // Write per-frame video/audio hash log to file? (not saved)
+    std::string frameverify;            // Verify frames against a hash log, failing on mismatch? (not saved)
+    std::string siddump;                // Write SID register writes to a dump file? (not saved)
+    std::string soundlog;               // Write periodic audio pipeline stats to file? (not saved)
+    std::string bench;                  // Benchmark or check to run as name[:path], before exiting (not saved)
 
     std::string fkeys =                 // Function key bindings
         "F1=InsertDisk1,SF1=EjectDisk1,AF1=NewDisk1,CF1=SaveDisk1,"
@@ -0,0 +1,193 @@
+// Part of SimCoupe - A SAM Coupe emulator
+//
+// Resampler.cpp: Band-limited sample rate conversion
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+// Notes:
+//  Converts 16-bit stereo samples by an arbitrary fractional step, which is
+//  the number of input samples consumed per output sample. Each output is a
+//  Kaiser-windowed sinc interpolation of the surrounding input, using a
+//  finely sampled kernel table with linear interpolation between entries.
+//  When decimating (step > 1) the kernel is stretched to lower the cutoff,
+//  which keeps the output band-limited at the cost of more taps per sample.
+//
+//  Input is buffered between calls, so the step can change from one call to
+//  the next without discontinuities. The output lags the input by the kernel
+//  half-width (16 samples at unity step).
+//
+//  The resample benchmark runs frames of a two-tone test signal through
+//  the resampler at a range of speeds, and reports the CPU time per frame.
+
+#include "SimCoupe.h"
+#include "Resampler.h"
+
+#include "Sound.h"
+
+constexpr int HALF_TAPS = 16;           // kernel zero-crossings either side of centre, at unity step
+constexpr int TABLE_RES = 256;          // kernel table entries per input sample
+constexpr double CUTOFF = 0.92;         // passband edge as a fraction of the Nyquist frequency
+constexpr double KAISER_BETA = 8.0;     // window shape (stop-band attenuation vs transition width)
+constexpr double MAX_STEP = 10.0;       // limit for 1000% emulation speed
+constexpr double PI = 3.14159265358979323846;
+constexpr int BENCH_FRAMES = EMULATED_FRAMES_PER_SECOND * 60;
+
+// Zeroth-order modified Bessel function, for the Kaiser window
+static double BesselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; ++k)
+    {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+Resampler::Resampler()
+{
+    m_table.resize(HALF_TAPS * TABLE_RES + 2);
+
+    for (size_t i = 0; i < m_table.size(); ++i)
+    {
+        double x = static_cast<double>(i) / TABLE_RES;
+        double sinc = (i == 0) ? 1.0 : std::sin(PI * CUTOFF * x) / (PI * CUTOFF * x);
+
+        double r = std::min(x / HALF_TAPS, 1.0);
+        double window = BesselI0(KAISER_BETA * std::sqrt(1.0 - r * r)) / BesselI0(KAISER_BETA);
+
+        m_table[i] = static_cast<float>(CUTOFF * sinc * window);
+    }
+
+    Reset();
+}
+
+void Resampler::Reset()
+{
+    // Start with silent history, so the first outputs have a full kernel of input
+    m_input.assign(HALF_TAPS * 2 * 2, 0);
+    m_pos = HALF_TAPS;
+}
+
+int Resampler::Process(const int16_t* in, int in_samples, int16_t* out, int max_out, double step)
+{
+    step = std::clamp(step, 1.0 / MAX_STEP, MAX_STEP);
+    m_input.insert(m_input.end(), in, in + in_samples * 2);
+
+    // Stretch the kernel when decimating, to lower the cutoff below the output Nyquist
+    double scale = std::max(1.0, step);
+    double width = HALF_TAPS * scale;
+    double table_step = TABLE_RES / scale;
+    float gain = static_cast<float>(1.0 / scale);
+
+    int available = static_cast<int>(m_input.size() / 2);
+    auto pi = m_input.data();
+    auto pt = m_table.data();
+
+    int num_out = 0;
+    while (num_out < max_out)
+    {
+        int first = static_cast<int>(std::floor(m_pos - width)) + 1;
+        int last = static_cast<int>(std::floor(m_pos + width));
+        if (last >= available)
+            break;
+
+        // Walk outwards from the centre in each direction, stepping through the kernel table
+        int centre = static_cast<int>(std::floor(m_pos));
+        auto frac = static_cast<float>(m_pos - centre);
+        auto x_step = static_cast<float>(table_step);
+
+        float left = 0.0f, right = 0.0f;
+        float x = frac * x_step;
+        for (int i = centre; i >= std::max(first, 0); --i, x += x_step)
+        {
+            auto index = static_cast<int>(x);
+            float h = pt[index] + (pt[index + 1] - pt[index]) * (x - index);
+            left += h * pi[i * 2];
+            right += h * pi[i * 2 + 1];
+        }
+
+        x = (1.0f - frac) * x_step;
+        for (int i = centre + 1; i <= last; ++i, x += x_step)
+        {
+            auto index = static_cast<int>(x);
+            float h = pt[index] + (pt[index + 1] - pt[index]) * (x - index);
+            left += h * pi[i * 2];
+            right += h * pi[i * 2 + 1];
+        }
+
+        out[num_out * 2] = static_cast<int16_t>(std::clamp(std::lround(left * gain), -32768L, 32767L));
+        out[num_out * 2 + 1] = static_cast<int16_t>(std::clamp(std::lround(right * gain), -32768L, 32767L));
+        num_out++;
+
+        m_pos += step;
+    }
+
+    // Discard input that's no longer needed by the widest kernel
+    int discard = std::clamp(static_cast<int>(std::floor(m_pos - HALF_TAPS * MAX_STEP)), 0, available);
+    if (discard > 0)
+    {
+        m_input.erase(m_input.begin(), m_input.begin() + discard * 2);
+        m_pos -= discard;
+    }
+
+    return num_out;
+}
+
+std::string Resampler::Benchmark()
+{
+    // One second of 1kHz and 5kHz tones, fed in a frame at a time
+    auto samples_per_frame = Sound::SamplesPerFrame();
+    std::vector<int16_t> input(static_cast<size_t>(Sound::SampleFreq()) * 2);
+    for (size_t i = 0; i < input.size() / 2; ++i)
+    {
+        auto t = static_cast<double>(i) / Sound::SampleFreq();
+        auto val = 12000 * std::sin(2 * PI * 1000 * t) + 6000 * std::sin(2 * PI * 5000 * t);
+        input[i * 2] = input[i * 2 + 1] = static_cast<int16_t>(val);
+    }
+
+    // Normal speed, the queue level trim limits, and the speed option limits
+    static constexpr std::array<std::pair<const char*, double>, 5> cases{ {
+        { "100%", 1.0 }, { "100% -trim", 0.995 }, { "100% +trim", 1.005 }, { "50%", 0.5 }, { "1000%", MAX_STEP } } };
+
+    std::vector<int16_t> output(static_cast<size_t>(samples_per_frame) * 2 * 2 + 2);
+    auto report = fmt::format("Resampler benchmark: {} frames of {} samples at {}Hz\n",
+        BENCH_FRAMES, samples_per_frame, Sound::SampleFreq());
+
+    for (auto& [name, step] : cases)
+    {
+        Resampler resampler;
+        size_t pos = 0, total_out = 0;
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+
+        for (int frame = 0; frame < BENCH_FRAMES; ++frame)
+        {
+            if (pos + samples_per_frame * 2 > input.size())
+                pos = 0;
+
+            total_out += resampler.Process(input.data() + pos, samples_per_frame,
+                output.data(), static_cast<int>(output.size() / 2), step);
+            pos += samples_per_frame * 2;
+        }
+
+        auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start_time).count();
+        auto per_frame = elapsed / BENCH_FRAMES;
+        report += fmt::format("  {:<11} {:6.1f}us per frame ({:.2f}% of frame time), {} samples out\n",
+            name, per_frame, per_frame * EMULATED_FRAMES_PER_SECOND / 10'000.0, total_out);
+    }
+
+    return report;
+}
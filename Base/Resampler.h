@@ -0,0 +1,35 @@
+// Part of SimCoupe - A SAM Coupe emulator
+//
+// Resampler.h: Band-limited sample rate conversion
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#pragma once
+
+class Resampler
+{
+public:
+    Resampler();
+
+    void Reset();
+    int Process(const int16_t* in, int in_samples, int16_t* out, int max_out, double step);
+
+    static std::string Benchmark();
+
+protected:
+    std::vector<float> m_table;
+    std::vector<int16_t> m_input;
+    double m_pos = 0.0;
+};
@@ -126,12 +126,12 @@ bool Init()
         pAtomLite = std::make_unique<AtomLiteDevice>();
         pSDIDE = std::make_unique<SDIDEDevice>();
 
-        pDAC = std::make_unique<DAC>();
-        pSAA = std::make_unique<SAADevice>();
-        pSID = std::make_unique<SIDDevice>();
-        pBeeper = std::make_unique<BeeperDevice>();
+        pDAC = std::make_unique<DAC>(Sound::SampleFreq());
+        pSAA = std::make_unique<SAADevice>(*pDAC);
+        pSID = std::make_unique<SIDDevice>(*pDAC);
+        pBeeper = std::make_unique<BeeperDevice>(Sound::SampleFreq());
         pSampler = std::make_unique<BASamplerDevice>();
-        pVoiceBox = std::make_unique<VoiceBoxDevice>();
+        pVoiceBox = std::make_unique<VoiceBoxDevice>(*pDAC);
         pSAMVox = std::make_unique<SAMVoxDevice>();
         pPaula = std::make_unique<PaulaDevice>();
         pMidi = std::make_unique<MidiDevice>();
@@ -213,6 +213,7 @@ void Exit(bool reinit)
         pFloppy1.reset();
         pFloppy2.reset();
         pBootDrive.reset();
+        Disk::WaitForWrites();
 
         pAtom.reset();
         pAtomLiteLeft.reset();
@@ -447,9 +448,12 @@ uint8_t In(uint16_t port)
             if (!(port_high & 0x01)) keys &= key_matrix[0];
         }
 
-        return keys |
+        auto val = keys |
             (m_state.border & BORDER_SOFF_MASK) |
             (m_state.keyboard & (KEYBOARD_EAR_MASK | KEYBOARD_SPEN_MASK));
+
+        Tape::EdgeLoopHook(port, val);
+        return val;
     }
 
     case STATUS_PORT:
@@ -837,6 +841,7 @@ void FrameUpdate()
     pAtomLiteLeft->FrameEnd();
     pAtomLite->FrameEnd();
     pPrinterFile->FrameEnd();
+    pSampler->FrameEnd();
 
     Input::Update();
     Sound::FrameUpdate(Frame::TurboMode());
@@ -1000,6 +1005,75 @@ void EiHook()
     Tape::EiHook();
 }
 
+// Complete the ROM's HLOAD hook by reading the file data straight from the disk image.
+// The DOS has just fetched the file header with HGTHD, so the file is identified by the
+// header it left in HDL, on the floppy drive it accessed to do that.
+static bool DosLoadTrap()
+{
+    constexpr uint16_t HDL = 0x4b50;        // header of file found by the DOS
+    constexpr uint16_t RST8V = 0x5aee;      // RST 8 handler vector
+    constexpr uint16_t DOSFLG = 0x5bc2;     // DOS page, or zero if not loaded
+    constexpr uint16_t DOSCNT = 0x5bc3;     // bit 0 set for errors handled by BASIC
+    constexpr size_t TYPE_NAME_LEN = 11;
+
+    if (!GetOption(disktraps))
+        return false;
+
+    // The system variables must be paged in, with the DOS loaded and nothing intercepting the hook
+    if (GetSectionPage(Section::B) != INTMEM || !read_byte(DOSFLG) || (read_byte(DOSCNT) & 1) || read_word(RST8V))
+        return false;
+
+    // Only trap loads into section C, leaving anything else to the DOS
+    auto dest_addr = cpu.get_hl();
+    if (dest_addr < 0x8000 || dest_addr >= 0xc000)
+        return false;
+
+    DiskDevice* drive = nullptr;
+    for (auto& floppy : { std::make_pair(GetOption(drive1), pFloppy1.get()), std::make_pair(GetOption(drive2), pFloppy2.get()) })
+    {
+        if (floppy.first == drvFloppy && floppy.second && floppy.second->IsActive())
+        {
+            if (drive)
+                return false;
+
+            drive = floppy.second;
+        }
+    }
+
+    if (!drive)
+        return false;
+
+    std::array<uint8_t, TYPE_NAME_LEN> type_name{};
+    for (size_t i = 0; i < type_name.size(); ++i)
+        type_name[i] = read_byte(static_cast<uint16_t>(HDL + i));
+
+    // Length is given as a page count in C and the remainder in DE, as for the DOS
+    auto length = (static_cast<size_t>(cpu.get_c()) << 14) | (cpu.get_de() & 0x7fff);
+    auto file = drive->ReadFile(type_name, length);
+    if (!file)
+        return false;
+
+    for (auto b : *file)
+    {
+        write_byte(dest_addr++, b);
+
+        // Advance to the next page when passing the end of section C
+        if (dest_addr >= 0xc000)
+        {
+            out_hmpr((State().hmpr & ~HMPR_PAGE_MASK) | ((State().hmpr + 1) & HMPR_PAGE_MASK));
+            dest_addr -= 0x4000;
+        }
+    }
+
+    // Return from the hook past the code byte, reporting success as the DOS would
+    write_byte(DOSCNT, 0);
+    cpu.set_a(0);
+    cpu.set_f((cpu.get_f() & ~cpu.cf_mask) | cpu.zf_mask);
+    cpu.set_pc(cpu.get_pc() + 1);
+
+    return true;
+}
+
 bool Rst8Hook()
 {
     if (AddrPage(cpu.get_pc()) != ROM0 && AddrPage(cpu.get_pc()) != ROM1)
@@ -1046,6 +1120,11 @@ bool Rst8Hook()
         }
         break;
 
+    // DOS HLOAD hook
+    case 0x82:
+        Keyin::Stop();
+        return DosLoadTrap();
+
     // Copyright message
     case 0x50:
         g_nTurbo &= ~TURBO_BOOT;
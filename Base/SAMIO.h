@@ -231,6 +231,8 @@ public:
     virtual bool Insert(const std::vector<uint8_t>& mem_file) { return false; }
     virtual void Eject() { }
     virtual void Flush() { }
+    virtual bool CommitOverlay() { return true; }
+    virtual bool DiscardOverlay() { return true; }
 
 public:
     virtual std::string DiskPath() const = 0;
@@ -240,6 +242,8 @@ public:
     virtual bool IsLightOn() const { return false; }
     virtual bool IsActive() const { return m_uActive != 0; }
 
+    virtual std::optional<std::vector<uint8_t>> ReadFile(span<const uint8_t> type_name, size_t size) { return std::nullopt; }
+
 protected:
     unsigned int m_uActive = 0; // active when non-zero, decremented by FrameEnd()
 };
@@ -18,6 +18,17 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
+// Notes:
+//  The sidsampling option selects the reSID sampling method, in the order
+//  of reSID's sampling_method enum: 0=fast, 1=interpolate, 2=resample
+//  (interpolated), 3=resample (fast). The resampling modes use a long FIR
+//  filter so they're much more expensive, but give the cleanest output.
+//
+//  The siddump option writes each SID register write as a line holding
+//  the output sample index, register and value. The sid benchmark then
+//  renders such a dump in each sampling method, and reports the CPU time
+//  and the error relative to the interpolated resampling output.
+
 #include "SimCoupe.h"
 #include "SID.h"
 
@@ -25,66 +36,197 @@
 #include "Options.h"
 
 
-SIDDevice::SIDDevice()
+constexpr int NUM_SAMPLING_METHODS = 4;
+constexpr int BENCH_REFERENCE_METHOD = 2;  // resample (interpolated)
+constexpr int BENCH_MAX_LAG = 64;          // samples either side to align outputs
+
+SIDDevice::SIDDevice(const DAC& clock) :
+    DeferredSoundDevice(clock)
 {
     m_sid = std::make_unique<SID>();
     Reset();
-}
 
-void SIDDevice::Reset()
-{
-    if (m_sid)
+    if (!GetOption(siddump).empty())
     {
-        m_chip_type = GetOption(sid);
-        m_sid->set_chip_model((m_chip_type == 2) ? MOS8580 : MOS6581);
-
-        m_sid->reset();
-        m_sid->adjust_sampling_frequency(SAMPLE_FREQ);
+        m_dump_file = fopen(GetOption(siddump).c_str(), "w");
+        if (!m_dump_file)
+            Message(MsgType::Warning, "Failed to create SID dump file:\n\n{}", GetOption(siddump));
     }
 }
 
-void SIDDevice::Update(bool fFrameEnd_ = false)
+void SIDDevice::Reset()
 {
-    int nSamplesSoFar = fFrameEnd_ ? pDAC->GetSampleCount() : pDAC->GetSamplesSoFar();
+    // The chip reset is logged, to apply in sequence with any pending writes
+    m_chip_type = GetOption(sid);
+    Queue(SoundOp::Reset, 0, static_cast<uint8_t>(m_chip_type));
 
-    int nNeeded = nSamplesSoFar - m_samples_this_frame;
-    if (!m_sid || nNeeded <= 0)
-        return;
+    m_sampling = SamplingMethod();
+    Queue(SoundOp::Config, 0, static_cast<uint8_t>(m_sampling));
+}
 
-    auto ps = reinterpret_cast<short*>(m_sample_buffer.data() + m_samples_this_frame * BYTES_PER_SAMPLE);
+int SIDDevice::SamplingMethod()
+{
+    return std::clamp(GetOption(sidsampling), 0, NUM_SAMPLING_METHODS - 1);
+}
 
-    if (CPU::reset_asserted)
-        memset(ps, 0x00, nNeeded * BYTES_PER_SAMPLE); // no clock means no output
-    else
+void SIDDevice::FrameEnd()
+{
+    if (GetOption(sid) != m_chip_type)
+        Reset();
+    else if (SamplingMethod() != m_sampling)
     {
-        int sid_clock = SID_CLOCK_PAL;
+        m_sampling = SamplingMethod();
+        Queue(SoundOp::Config, 0, static_cast<uint8_t>(m_sampling));
+    }
 
-        // Generate the mono SID samples for the left channel
-        m_sid->clock(sid_clock, ps, nNeeded, 2);
+    m_dump_samples += m_clock.GetSampleCount();
+    DeferredSoundDevice::FrameEnd();
+}
 
-        // Duplicate the left samples for the right channel
-        for (int i = 0; i < nNeeded; i++, ps += 2)
-            ps[1] = ps[0];
-    }
+void SIDDevice::Out(uint16_t wPort_, uint8_t bVal_)
+{
+    if (m_dump_file)
+        fmt::print(m_dump_file, "{} {} {}\n", m_dump_samples + m_clock.GetSamplesSoFar(), (wPort_ >> 8) & 0x1f, bVal_);
 
-    m_samples_this_frame = nSamplesSoFar;
+    DeferredSoundDevice::Out(wPort_, bVal_);
 }
 
-void SIDDevice::FrameEnd()
+void SIDDevice::Generate(uint8_t* pb, int samples)
 {
-    if (GetOption(sid) != m_chip_type)
-        Reset();
+    auto ps = reinterpret_cast<short*>(pb);
+    int sid_clock = SID_CLOCK_PAL;
 
-    Update(true);
-    m_samples_this_frame = 0;
+    // Generate the mono SID samples for the left channel
+    m_sid->clock(sid_clock, ps, samples, 2);
+
+    // Duplicate the left samples for the right channel
+    for (int i = 0; i < samples; i++, ps += 2)
+        ps[1] = ps[0];
+}
+
+void SIDDevice::Apply(const SoundWrite& write)
+{
+    if (write.op == SoundOp::Reset)
+    {
+        m_sid->set_chip_model((write.val == 2) ? MOS8580 : MOS6581);
+        m_sid->reset();
+    }
+    else if (write.op == SoundOp::Config)
+    {
+        auto method = static_cast<sampling_method>(write.val);
+        if (!m_sid->set_sampling_parameters(SID_CLOCK_PAL, method, m_sample_freq))
+        {
+            TRACE("SID sampling method {} not supported, using fast\n", write.val);
+            m_sid->set_sampling_parameters(SID_CLOCK_PAL, SAMPLE_FAST, m_sample_freq);
+        }
+    }
+    else
+    {
+        uint8_t reg = write.port >> 8;
+        m_sid->write(reg & 0x1f, write.val);
+    }
 }
 
-void SIDDevice::Out(uint16_t port, uint8_t val)
+////////////////////////////////////////////////////////////////////////////////
+
+// Render a register dump with each sampling method, reporting the time taken and the error
+std::string SIDDevice::Benchmark(const std::string& dump_path)
 {
-    Update();
+    struct DumpWrite { uint64_t sample; unsigned int reg, val; };
+    std::vector<DumpWrite> writes;
+
+    std::ifstream ifs(dump_path);
+    if (!ifs)
+        return fmt::format("Failed to open SID dump:\n\n{}", dump_path);
+
+    DumpWrite write{};
+    while (ifs >> write.sample >> write.reg >> write.val)
+        writes.push_back(write);
+
+    if (writes.empty())
+        return fmt::format("No SID writes found in:\n\n{}", dump_path);
+
+    // Render one second beyond the final write, to include the release
+    auto total_samples = static_cast<size_t>(writes.back().sample + Sound::SampleFreq());
+    std::array<std::vector<short>, NUM_SAMPLING_METHODS> outputs;
+    std::array<double, NUM_SAMPLING_METHODS> times{};
+
+    for (int method = 0; method < NUM_SAMPLING_METHODS; ++method)
+    {
+        SID sid;
+        sid.set_chip_model((GetOption(sid) == 2) ? MOS8580 : MOS6581);
+        sid.reset();
+        sid.set_sampling_parameters(SID_CLOCK_PAL, static_cast<sampling_method>(method), Sound::SampleFreq());
+
+        auto& output = outputs[method];
+        output.resize(total_samples);
+        size_t pos = 0;
+
+        auto render = [&](size_t end_pos)
+        {
+            while (pos < end_pos)
+            {
+                int sid_clock = SID_CLOCK_PAL;
+                pos += sid.clock(sid_clock, output.data() + pos, static_cast<int>(end_pos - pos));
+            }
+        };
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+
+        for (auto& w : writes)
+        {
+            render(static_cast<size_t>(w.sample));
+            sid.write(w.reg & 0x1f, w.val);
+        }
+        render(total_samples);
+
+        times[method] = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_time).count();
+    }
+
+    static constexpr std::array<const char*, NUM_SAMPLING_METHODS> method_names{
+        "fast", "interpolate", "resample", "resample fast" };
 
-    uint8_t reg = port >> 8;
+    auto seconds = static_cast<double>(total_samples) / Sound::SampleFreq();
+    auto report = fmt::format("SID benchmark: {} writes, {:.1f}s of audio\n", writes.size(), seconds);
+    auto& reference = outputs[BENCH_REFERENCE_METHOD];
+
+    for (int method = 0; method < NUM_SAMPLING_METHODS; ++method)
+    {
+        auto& output = outputs[method];
+        auto measure = [&](int lag, size_t end_pos, double& signal)
+        {
+            double noise = 0.0;
+            signal = 0.0;
+            for (size_t i = BENCH_MAX_LAG; i < end_pos; ++i)
+            {
+                double ref = reference[i];
+                double diff = output[i + lag] - ref;
+                noise += diff * diff;
+                signal += ref * ref;
+            }
+            return noise;
+        };
+
+        // Find the lag that best aligns with the reference (over the first few seconds),
+        // as the methods have different filter delays
+        auto align_end = std::min(total_samples, static_cast<size_t>(Sound::SampleFreq() * 5)) - BENCH_MAX_LAG;
+        double best_noise = std::numeric_limits<double>::max(), signal = 0.0;
+        int best_lag = 0;
+        for (int lag = -BENCH_MAX_LAG; lag <= BENCH_MAX_LAG; ++lag)
+        {
+            auto noise = measure(lag, align_end, signal);
+            if (noise < best_noise)
+            {
+                best_noise = noise;
+                best_lag = lag;
+            }
+        }
+
+        auto noise = measure(best_lag, total_samples - BENCH_MAX_LAG, signal);
+        auto snr = (noise > 0.0) ? fmt::format("{:.1f}dB", 10.0 * std::log10(signal / noise)) : std::string("exact");
+        report += fmt::format("\n{}: {:.0f}ms ({:.2f}% of real time), SNR {} (lag {})",
+            method_names[method], times[method] * 1000.0, times[method] * 100.0 / seconds, snr, best_lag);
+    }
 
-    if (m_sid)
-        m_sid->write(reg & 0x1f, val);
+    return report;
 }
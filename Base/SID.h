@@ -27,21 +27,31 @@
 #include "../resid-src/sid.h"
 #define SID_CLOCK_PAL   985248
 
-class SIDDevice final : public SoundDevice
+class SIDDevice final : public DeferredSoundDevice
 {
 public:
-    SIDDevice();
+    explicit SIDDevice(const DAC& clock);
+    ~SIDDevice() { Sync(); }
 
 public:
     void Reset() override;
-    void Update(bool fFrameEnd_);
     void FrameEnd() override;
-
     void Out(uint16_t wPort_, uint8_t bVal_) override;
 
+    static std::string Benchmark(const std::string& dump_path);
+
+protected:
+    void Generate(uint8_t* pb, int samples) override;
+    void Apply(const SoundWrite& write) override;
+    static int SamplingMethod();
+
 protected:
     std::unique_ptr<SID> m_sid;
     int m_chip_type = 0;
+    int m_sampling = 0;
+
+    unique_FILE m_dump_file;
+    uint64_t m_dump_samples = 0;
 };
 
 extern std::unique_ptr<SIDDevice> pSID;
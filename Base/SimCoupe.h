@@ -75,7 +75,12 @@
 #include <optional>
 #include <variant>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
 #include <numeric>
+#include <random>
 #include <regex>
 #include <fstream>
 
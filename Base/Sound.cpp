@@ -25,15 +25,61 @@
 #include "AVI.h"
 #include "CPU.h"
 #include "Frame.h"
+#include "FrameLog.h"
 #include "Options.h"
+#include "Resampler.h"
 #include "SID.h"
 #include "VoiceBox.h"
 #include "WAV.h"
 
+constexpr int MIX_GAIN_BITS = 12;       // fixed-point fraction bits for mix gains
+constexpr int MAX_MIX_GAIN = 200;       // maximum device gain percentage
+constexpr float MAX_RATE_ADJUST = 0.005f;   // maximum resampling trim to hold the audio queue level
+constexpr float TRIM_STAT_THRESHOLD = 0.001f;   // trim counted as a rate intervention in the stats
+
+// Mix graph node settings for each sound device, parsed from the mixer option
+struct MixNode
+{
+    std::string name;
+    int gain = 100;     // percentage (0 = muted)
+    int pan = 0;        // -100 (left) to +100 (right)
+};
+
+enum { MIX_DAC, MIX_SAA, MIX_SID, MIX_VOICEBOX, MIX_BEEPER, NUM_MIX_NODES };
+static std::array<MixNode, NUM_MIX_NODES> mix_nodes{ {
+    { "dac" }, { "saa" }, { "sid" }, { "voicebox" }, { "beeper" } } };
+static std::string mix_config;
+
 static uint8_t* pbSampleBuffer;
+static std::vector<int32_t> mix_buffer;
+static std::vector<int16_t> resample_buffer;
+static Resampler resampler;
+static float buffer_level = 0.5f;
+static bool audio_available;
 
-static void MixAudio(uint8_t* pDst_, const uint8_t* pSrc_, int nLen_);
-static int AdjustSpeed(uint8_t* pb_, int nSize_, int nSpeed_);
+// Audio pipeline telemetry, accumulated over each reporting interval
+struct SoundStats
+{
+    int frames = 0;
+    int output_frames = 0;
+    float queue_min = 0.0f, queue_max = 0.0f, queue_total = 0.0f;
+    int trim_frames = 0;
+    std::array<std::chrono::microseconds, NUM_MIX_NODES> frame_end_time{};
+    std::array<std::chrono::microseconds, NUM_MIX_NODES> synth_time{};
+    std::chrono::microseconds mix_time{}, resample_time{};
+};
+
+static SoundStats stats;
+static std::optional<std::chrono::steady_clock::time_point> stats_start;
+static uint32_t last_underruns, last_overruns;
+static std::string stats_text;
+static unique_FILE stats_log;
+static double stats_log_time;
+
+static void UpdateStats();
+static void UpdateMixNodes();
+static void MixDevice(const uint8_t* pb, const MixNode& node, int num_samples);
+static void ClampMix(uint8_t* pb_, int num_samples);
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -41,21 +87,60 @@ bool Sound::Init()
 {
     Exit();
 
-    int nMaxFrameSamples = 2; // Needed for 50% running speed
-    int nSamplesPerFrame = (SAMPLE_FREQ / EMULATED_FRAMES_PER_SECOND) + 1;
-    pbSampleBuffer = new uint8_t[nSamplesPerFrame * BYTES_PER_SAMPLE * nMaxFrameSamples];
+    int nMaxFrameSamples = 3; // Resampled output at 50% running speed, plus rate trim
+    int nSamplesPerFrame = SamplesPerFrame() + 1;
+    pbSampleBuffer = new uint8_t[nSamplesPerFrame * BYTES_PER_SAMPLE];
+    mix_buffer.resize(nSamplesPerFrame * SAMPLE_CHANNELS);
+    resample_buffer.resize(nSamplesPerFrame * SAMPLE_CHANNELS * nMaxFrameSamples);
+    resampler.Reset();
+    buffer_level = 0.5f;
+    mix_config.clear();
+
+    stats = {};
+    stats_start.reset();
+    stats_text.clear();
+    stats_log_time = 0.0;
+
+    if (!GetOption(soundlog).empty())
+    {
+        stats_log = fopen(GetOption(soundlog).c_str(), "w");
+        if (!stats_log)
+            Message(MsgType::Warning, "Failed to create sound log:\n\n{}", GetOption(soundlog));
+    }
 
-    bool fRet = Audio::Init();
+    bool fRet = audio_available = Audio::Init();
+    last_underruns = Audio::Underruns();
+    last_overruns = Audio::Overruns();
     return fRet;
 }
 
+// The output rate is fixed on first use, as the devices and host audio are created for it
+int Sound::SampleFreq()
+{
+    static const int sample_freq = []
+    {
+        auto freq = GetOption(samplerate);
+        if (freq == 44100 || freq == 48000 || freq == 96000)
+            return freq;
+
+        return DEFAULT_SAMPLE_FREQ;
+    }();
+
+    return sample_freq;
+}
+
 void Sound::Exit()
 {
     // Stop any recording
     WAV::Stop();
     AVI::Stop();
 
+    stats_log.reset();
+
     delete[] pbSampleBuffer; pbSampleBuffer = nullptr;
+    mix_buffer.clear();
+    resample_buffer.clear();
+
     Audio::Exit();
 }
 
@@ -64,38 +149,98 @@ void Sound::FrameUpdate(bool turbo)
     static bool fSidUsed = false;
     static bool sp0256_used = false;
 
+    using namespace std::chrono;
+    UpdateStats();
+
     // Track whether devices have been used, to avoid unnecessary sample generation+mixing
-    fSidUsed |= pSID->GetSampleCount() != 0;
+    fSidUsed |= pSID->IsUsed();
     sp0256_used |= pVoiceBox->GetSampleCount() != 0;
 
-    pDAC->FrameEnd();   // set the actual sample count
-    pSAA->FrameEnd();   // catch-up to the DAC position
-    if (fSidUsed) pSID->FrameEnd();
-    if (sp0256_used) pVoiceBox->FrameEnd();
+    auto timed_frame_end = [&](SoundDevice& device, int node)
+    {
+        auto start_time = high_resolution_clock::now();
+        device.FrameEnd();
+        stats.frame_end_time[node] += duration_cast<microseconds>(high_resolution_clock::now() - start_time);
+    };
+
+    timed_frame_end(*pDAC, MIX_DAC);    // set the actual sample count
+    timed_frame_end(*pSAA, MIX_SAA);    // catch-up to the DAC position
+    timed_frame_end(*pBeeper, MIX_BEEPER);
+    if (fSidUsed) timed_frame_end(*pSID, MIX_SID);
+    if (sp0256_used) timed_frame_end(*pVoiceBox, MIX_VOICEBOX);
+
+    // Collect any threaded SAA/SID output, rendered alongside the inline devices above
+    pSAA->Sync();
+    pSID->Sync();
+
+    stats.synth_time[MIX_SAA] += pSAA->TakeSynthTime();
+    stats.synth_time[MIX_SID] += pSID->TakeSynthTime();
+    stats.frames++;
+
+    auto mix_start = high_resolution_clock::now();
 
     // Use the DAC as the primary clock for sample count
     int nSamples = pDAC->GetSampleCount();
+
+    std::array<const uint8_t*, NUM_MIX_NODES> buffers{};
+    buffers[MIX_DAC] = pDAC->GetSampleBuffer();
+    buffers[MIX_SAA] = pSAA->GetSampleBuffer();
+    buffers[MIX_SID] = pSID->GetSampleBuffer();
+    buffers[MIX_VOICEBOX] = pVoiceBox->GetSampleBuffer();
+    buffers[MIX_BEEPER] = pBeeper->GetSampleBuffer();
+
     int nSize = nSamples * BYTES_PER_SAMPLE;
 
-    // Copy in the DAC samples, then mix SAA and possibly SID too
-    memcpy(pbSampleBuffer, pDAC->GetSampleBuffer(), nSize);
-    MixAudio(pbSampleBuffer, pSAA->GetSampleBuffer(), nSize);
-    if (fSidUsed && GetOption(sid)) MixAudio(pbSampleBuffer, pSID->GetSampleBuffer(), nSize);
-    if (sp0256_used && GetOption(voicebox)) MixAudio(pbSampleBuffer, pVoiceBox->GetSampleBuffer(), nSize);
+    // Mix the active devices with their node gain and pan, then clip once at the end
+    UpdateMixNodes();
+    std::fill(mix_buffer.begin(), mix_buffer.begin() + nSamples * SAMPLE_CHANNELS, 0);
+
+    MixDevice(buffers[MIX_DAC], mix_nodes[MIX_DAC], nSamples);
+    MixDevice(buffers[MIX_SAA], mix_nodes[MIX_SAA], nSamples);
+    if (pBeeper->IsUsed()) MixDevice(buffers[MIX_BEEPER], mix_nodes[MIX_BEEPER], nSamples);
+    if (fSidUsed && GetOption(sid)) MixDevice(buffers[MIX_SID], mix_nodes[MIX_SID], nSamples);
+    if (sp0256_used && GetOption(voicebox)) MixDevice(buffers[MIX_VOICEBOX], mix_nodes[MIX_VOICEBOX], nSamples);
+
+    ClampMix(pbSampleBuffer, nSamples);
+    stats.mix_time += duration_cast<microseconds>(high_resolution_clock::now() - mix_start);
 
     // Add the frame to any recordings
     WAV::AddFrame(pbSampleBuffer, nSize);
     AVI::AddFrame(pbSampleBuffer, nSize);
+    FrameLog::AddAudio(pbSampleBuffer, nSize);
+
+    // Devices skip waveform generation next frame if nobody will hear or record it
+    auto recording = WAV::IsRecording() || AVI::IsRecording() || FrameLog::IsActive();
+    auto sink_active = recording || (!turbo && audio_available);
+    pDAC->SetSilent(!sink_active || !mix_nodes[MIX_DAC].gain);
+    pSAA->SetSilent(!sink_active || !mix_nodes[MIX_SAA].gain);
+    pSID->SetSilent(!sink_active || !mix_nodes[MIX_SID].gain || !GetOption(sid));
+    pVoiceBox->SetSilent(!sink_active || !mix_nodes[MIX_VOICEBOX].gain || !GetOption(voicebox));
+    pBeeper->SetSilent(!sink_active || !mix_nodes[MIX_BEEPER].gain);
 
     if (turbo)
         return;
 
-    if (SAMPLE_BITS == 16 && SAMPLE_CHANNELS == 2)
-        nSize = AdjustSpeed(pbSampleBuffer, nSize, GetOption(speed));
+    // Resample for the emulation speed, trimming the rate to keep the queue level (and latency) steady
+    auto speed = std::clamp(GetOption(speed), 50, 1000);
+    auto trim = 1.0f + MAX_RATE_ADJUST * (2.0f * buffer_level - 1.0f);
+    auto step = speed / 100.0 * trim;
 
-    auto buffer_level = Audio::AddData(pbSampleBuffer, nSize);
+    static_assert(SAMPLE_BITS == 16 && SAMPLE_CHANNELS == 2, "resampler format mismatch");
+    auto resample_start = high_resolution_clock::now();
+    auto out_samples = resampler.Process(reinterpret_cast<int16_t*>(pbSampleBuffer), nSamples,
+        resample_buffer.data(), static_cast<int>(resample_buffer.size() / SAMPLE_CHANNELS), step);
+    stats.resample_time += duration_cast<microseconds>(high_resolution_clock::now() - resample_start);
+
+    auto level = Audio::AddData(reinterpret_cast<uint8_t*>(resample_buffer.data()), out_samples * BYTES_PER_SAMPLE);
+    buffer_level += (std::clamp(level, 0.0f, 1.0f) - buffer_level) * 0.05f;
+
+    stats.queue_min = stats.output_frames ? std::min(stats.queue_min, level) : level;
+    stats.queue_max = stats.output_frames ? std::max(stats.queue_max, level) : level;
+    stats.queue_total += level;
+    stats.trim_frames += (speed != 100 || std::abs(trim - 1.0f) > TRIM_STAT_THRESHOLD) ? 1 : 0;
+    stats.output_frames++;
 
-    using namespace std::chrono;
     static high_resolution_clock::time_point frame_time;
     auto one_frame = duration_cast<microseconds>(
         seconds(1) / ACTUAL_FRAMES_PER_SECOND * 100.0f / GetOption(speed));
@@ -107,58 +252,372 @@ void Sound::FrameUpdate(bool turbo)
     }
     else if (!GetOption(audiosync) && GetOption(speed) == 100)
     {
-        auto max_adjust = 0.01f;
-        auto scale = (1.0f - max_adjust) + 2.0f * max_adjust * buffer_level;
-        frame_time += duration_cast<microseconds>(one_frame * scale);
+        frame_time += one_frame;
         std::this_thread::sleep_until(frame_time);
     }
 }
 
+// Called periodically during the frame, to let threaded devices render ahead
+void Sound::RenderAhead()
+{
+    pSAA->RenderAhead();
+    pSID->RenderAhead();
+}
+
+std::string Sound::GetStatsText()
+{
+    return stats_text;
+}
+
+// Summarise the audio telemetry once a second, for the OSD and any sound log
+static void UpdateStats()
+{
+    using namespace std::chrono;
+
+    auto now = steady_clock::now();
+    if (!stats_start)
+        stats_start = now;
+
+    auto elapsed = duration<double>(now - *stats_start).count();
+    if (elapsed < 1.0 || !stats.frames)
+        return;
+
+    auto underruns = Audio::Underruns() - last_underruns;
+    auto overruns = Audio::Overruns() - last_overruns;
+    last_underruns += underruns;
+    last_overruns += overruns;
+
+    auto per_frame = [&](microseconds time) { return static_cast<int>(time.count() / stats.frames); };
+    auto queue_avg = stats.output_frames ? stats.queue_total / stats.output_frames : 0.0f;
+
+    auto total_time = stats.mix_time + stats.resample_time;
+    for (int i = 0; i < NUM_MIX_NODES; ++i)
+        total_time += stats.frame_end_time[i] + stats.synth_time[i];
+
+    stats_text = fmt::format("q{:.0f}% u{} o{} t{} {}us",
+        queue_avg * 100, underruns, overruns, stats.trim_frames, per_frame(total_time));
+
+    if (stats_log)
+    {
+        // One JSON object per line, with times as average microseconds per frame
+        stats_log_time += elapsed;
+        auto line = fmt::format(R"({{"time":{:.3f},"frames":{},"output_frames":{},)"
+            R"("queue":{{"min":{:.3f},"avg":{:.3f},"max":{:.3f}}},"underruns":{},"overruns":{},"trim_frames":{},)",
+            stats_log_time, stats.frames, stats.output_frames,
+            stats.queue_min, queue_avg, stats.queue_max, underruns, overruns, stats.trim_frames);
+
+        line += R"("frame_end_us":{)";
+        for (int i = 0; i < NUM_MIX_NODES; ++i)
+            line += fmt::format(R"({}"{}":{})", i ? "," : "", mix_nodes[i].name, per_frame(stats.frame_end_time[i]));
+
+        line += fmt::format(R"(}},"synth_us":{{"saa":{},"sid":{}}},"mix_us":{},"resample_us":{}}})",
+            per_frame(stats.synth_time[MIX_SAA]), per_frame(stats.synth_time[MIX_SID]),
+            per_frame(stats.mix_time), per_frame(stats.resample_time));
+
+        fmt::print(stats_log, "{}\n", line);
+        fflush(stats_log);
+    }
+
+    stats = {};
+    stats_start = now;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
-void SAADevice::Update(bool fFrameEnd_ = false)
+SoundWorker::~SoundWorker()
 {
-    int nSamplesSoFar = fFrameEnd_ ? pDAC->GetSampleCount() : pDAC->GetSamplesSoFar();
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+
+        m_cv.notify_all();
+        m_thread.join();
+    }
+}
+
+void SoundWorker::Start(std::function<void()> job)
+{
+    Wait();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = std::move(job);
+        m_busy = true;
+    }
+
+    if (!m_thread.joinable())
+        m_thread = std::thread(&SoundWorker::ThreadProc, this);
 
-    int nNeeded = nSamplesSoFar - m_samples_this_frame;
-    if (nNeeded <= 0)
+    m_cv.notify_all();
+}
+
+void SoundWorker::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [&] { return !m_busy; });
+}
+
+bool SoundWorker::IsBusy()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_busy;
+}
+
+void SoundWorker::ThreadProc()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_cv.wait(lock, [&] { return m_busy || m_exit; });
+        if (m_exit)
+            break;
+
+        lock.unlock();
+        m_job();
+        lock.lock();
+
+        m_busy = false;
+        m_cv.notify_all();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+DeferredSoundDevice::DeferredSoundDevice(const DAC& clock) :
+    SoundDevice(clock.SampleFreq()), m_clock(clock)
+{
+    m_threaded = GetOption(soundthread);
+    m_render_buffer.resize(m_sample_buffer.size());
+}
+
+void DeferredSoundDevice::Out(uint16_t wPort_, uint8_t bVal_)
+{
+    Queue(SoundOp::Write, wPort_, bVal_);
+}
+
+void DeferredSoundDevice::Queue(SoundOp op, uint16_t port, uint8_t val)
+{
+    // Writes catch up to the current position first, other operations apply immediately
+    int sample_pos = (op == SoundOp::Write) ? m_clock.GetSamplesSoFar() : 0;
+    m_writes.push_back({ sample_pos, CPU::reset_asserted, op, port, val });
+    m_used |= (op == SoundOp::Write);
+
+    // Without a worker thread we synthesise up to the write straight away
+    if (!m_threaded)
+    {
+        Render(m_writes, m_silent);
+        m_writes.clear();
+    }
+}
+
+void DeferredSoundDevice::Render(const std::vector<SoundWrite>& writes, bool silent, int end_pos, bool end_reset)
+{
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    auto generate = [&](int sample_pos, bool reset)
+    {
+        int needed = sample_pos - m_render_pos;
+        if (needed <= 0)
+            return;
+
+        auto pb = m_render_buffer.data() + m_render_pos * BYTES_PER_SAMPLE;
+
+        // No clock means no output, and unheard output is skipped (leaving the chip idle)
+        if (reset || silent)
+            memset(pb, 0x00, needed * BYTES_PER_SAMPLE);
+        else
+            Generate(pb, needed);
+
+        m_render_pos = sample_pos;
+    };
+
+    for (auto& write : writes)
+    {
+        generate(write.sample_pos, write.reset);
+        Apply(write);
+    }
+
+    if (end_pos >= 0)
+        generate(end_pos, end_reset);
+
+    m_synth_us += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start_time).count();
+}
+
+void DeferredSoundDevice::FrameEnd()
+{
+    auto samples = m_clock.GetSampleCount();
+    auto reset = CPU::reset_asserted;
+    auto silent = m_silent;
+
+    if (!m_threaded)
+    {
+        Render(m_writes, silent, samples, reset);
+        m_writes.clear();
+
+        std::swap(m_sample_buffer, m_render_buffer);
+        m_samples_this_frame = samples;
+        m_render_pos = 0;
         return;
+    }
 
-    auto pb = m_sample_buffer.data() + m_samples_this_frame * BYTES_PER_SAMPLE;
+    // Hand the rest of the frame to the worker, with the output collected by Sync()
+    m_worker.Wait();
+    std::swap(m_writes, m_render_writes);
+    m_writes.clear();
+    m_render_samples = samples;
+    m_frame_pending = true;
 
-    if (CPU::reset_asserted)
-        memset(pb, 0x00, nNeeded * BYTES_PER_SAMPLE); // no clock means no SAA output
-    else
-        m_pSAASound->GenerateMany(pb, nNeeded);
+    m_worker.Start([this, samples, reset, silent] { Render(m_render_writes, silent, samples, reset); });
+}
+
+// Render the writes so far up to the current position, if the worker is free.
+// Nothing later can change the output before now, so this overlaps synthesis
+// with the rest of the frame's emulation.
+void DeferredSoundDevice::RenderAhead()
+{
+    if (!m_threaded || !m_used || m_frame_pending || m_worker.IsBusy())
+        return;
+
+    auto sample_pos = m_clock.GetSamplesSoFar();
+    auto reset = CPU::reset_asserted;
+    auto silent = m_silent;
+
+    std::swap(m_writes, m_render_writes);
+    m_writes.clear();
+
+    m_worker.Start([this, sample_pos, reset, silent] { Render(m_render_writes, silent, sample_pos, reset); });
+}
 
-    m_samples_this_frame = nSamplesSoFar;
+// Wait for the worker, and make any completed frame available to the mixer
+void DeferredSoundDevice::Sync()
+{
+    m_worker.Wait();
+
+    if (m_frame_pending)
+    {
+        std::swap(m_sample_buffer, m_render_buffer);
+        m_samples_this_frame = m_render_samples;
+        m_render_pos = 0;
+        m_frame_pending = false;
+    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
 void SAADevice::FrameEnd()
 {
-    m_pSAASound->SetHighpass(GetOption(saahighpass));
-    Update(true);
-    m_samples_this_frame = 0;
+    // Apply the high-pass setting before the final catch-up to the frame end
+    Queue(SoundOp::Config, 0, GetOption(saahighpass));
+    DeferredSoundDevice::FrameEnd();
 }
 
-void SAADevice::Out(uint16_t wPort_, uint8_t bVal_)
+void SAADevice::Generate(uint8_t* pb, int samples)
 {
-    Update();
+    m_pSAASound->GenerateMany(pb, samples);
+}
 
-    if ((wPort_ & SAA_MASK) == SAA_ADDR_PORT)
-        m_pSAASound->WriteAddress(bVal_);
+void SAADevice::Apply(const SoundWrite& write)
+{
+    if (write.op == SoundOp::Config)
+        m_pSAASound->SetHighpass(write.val != 0);
+    else if ((write.port & SAA_MASK) == SAA_ADDR_PORT)
+        m_pSAASound->WriteAddress(write.val);
     else
-        m_pSAASound->WriteData(bVal_);
+        m_pSAASound->WriteData(write.val);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void StepSynth::output(Blip_Buffer* buf)
+{
+    m_buf = buf;
+    m_last_amp = 0;
+    m_fast.output(buf);
+    m_med.output(buf);
+    m_high.output(buf);
+}
+
+void StepSynth::volume(double v)
+{
+    m_fast.volume(v);
+    m_med.volume(v);
+    m_high.volume(v);
+}
+
+void StepSynth::treble_eq(const blip_eq_t& eq)
+{
+    m_med.treble_eq(eq);
+    m_high.treble_eq(eq);
+}
+
+void StepSynth::update(blip_time_t time, int amp)
+{
+    int delta = amp - m_last_amp;
+    if (!delta)
+        return;
+
+    m_last_amp = amp;
+
+    switch (m_quality)
+    {
+    case SynthQuality::Fast:
+        m_fast.offset_inline(time, delta, m_buf);
+        break;
+
+    case SynthQuality::Normal:
+        m_med.offset_inline(time, delta, m_buf);
+        break;
+
+    case SynthQuality::High:
+        m_high.offset_inline(time, delta, m_buf);
+        break;
+    }
+}
+
+// Returns true if the output stage options have changed since the last call
+bool SynthConfig::Update()
+{
+    auto new_quality = std::clamp(GetOption(dacquality), 0, 2);
+    auto new_highpass = std::max(GetOption(dachighpass), 0);
+    auto new_lowpass = std::max(GetOption(daclowpass), 0);
+
+    if (new_quality == quality && new_highpass == highpass && new_lowpass == lowpass)
+        return false;
+
+    quality = new_quality;
+    highpass = new_highpass;
+    lowpass = new_lowpass;
+    return true;
+}
+
+void SynthConfig::Apply(Blip_Buffer& buf, std::initializer_list<StepSynth*> synths) const
+{
+    // DC-blocking high-pass, and either the default gentle treble roll-off or a
+    // steeper low-pass above the chosen frequency
+    buf.bass_freq(highpass);
+    auto eq = lowpass ? blip_eq_t(-24.0, lowpass, buf.sample_rate()) : blip_eq_t(-8.0);
+
+    for (auto synth : synths)
+    {
+        synth->set_quality(static_cast<SynthQuality>(quality));
+        synth->treble_eq(eq);
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-DAC::DAC()
+DAC::DAC(int sample_freq) :
+    SoundDevice(sample_freq)
 {
     buf_left.clock_rate(CPU_CLOCK_HZ);
     buf_right.clock_rate(CPU_CLOCK_HZ);
-    buf_left.set_sample_rate(SAMPLE_FREQ);
-    buf_right.set_sample_rate(SAMPLE_FREQ);
+    buf_left.set_sample_rate(sample_freq);
+    buf_right.set_sample_rate(sample_freq);
 
     synth_left.output(&buf_left);
     synth_left2.output(&buf_left);
@@ -170,9 +629,19 @@ DAC::DAC()
     synth_right.volume(1.0);
     synth_right2.volume(1.0);
 
+    Configure();
     Reset();
 }
 
+void DAC::Configure()
+{
+    if (m_config.Update())
+    {
+        m_config.Apply(buf_left, { &synth_left, &synth_left2 });
+        m_config.Apply(buf_right, { &synth_right, &synth_right2 });
+    }
+}
+
 void DAC::Reset()
 {
     Output(0);
@@ -183,9 +652,18 @@ void DAC::FrameEnd()
 {
     buf_left.end_frame(CPU_CYCLES_PER_FRAME);
     buf_right.end_frame(CPU_CYCLES_PER_FRAME);
+    Configure();
 
     m_samples_this_frame = static_cast<int>(buf_left.samples_avail());
 
+    if (m_silent)
+    {
+        buf_left.remove_samples(m_samples_this_frame);
+        buf_right.remove_samples(m_samples_this_frame);
+        memset(m_sample_buffer.data(), 0, m_samples_this_frame * BYTES_PER_SAMPLE);
+        return;
+    }
+
     auto ps = reinterpret_cast<blip_sample_t*>(m_sample_buffer.data());
     buf_left.read_samples(ps, m_samples_this_frame, 1);
     buf_right.read_samples(ps + 1, m_samples_this_frame, 1);
@@ -223,82 +701,397 @@ void DAC::Output2(uint8_t bVal_)
     synth_right2.update(CPU::frame_cycles, bVal_);
 }
 
-int DAC::GetSamplesSoFar()
+int DAC::GetSamplesSoFar() const
 {
     auto cpu_cycles = std::min(CPU::frame_cycles, static_cast<uint32_t>(CPU_CYCLES_PER_FRAME));
     return static_cast<int>(buf_left.count_samples(cpu_cycles));
 }
 
+// Time each synthesis quality under heavy sample playback: four channels of
+// 8-bit samples at about 31kHz, as SAMVox or Paula playback would give
+std::string DAC::Benchmark()
+{
+    static constexpr std::array<const char*, 3> quality_names{ "fast", "normal", "high" };
+    constexpr int bench_frames = EMULATED_FRAMES_PER_SECOND * 100;
+    constexpr uint32_t write_cycles = 192;
+
+    auto saved_quality = GetOption(dacquality);
+    auto saved_frame_cycles = CPU::frame_cycles;
+    std::array<double, quality_names.size()> times{};
+
+    for (size_t quality = 0; quality < quality_names.size(); ++quality)
+    {
+        SetOption(dacquality, static_cast<int>(quality));
+        DAC dac(Sound::SampleFreq());
+        uint32_t seed = 1;
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+
+        for (int frame = 0; frame < bench_frames; ++frame)
+        {
+            for (uint32_t cycle = 0; cycle < CPU_CYCLES_PER_FRAME - 32; cycle += write_cycles)
+            {
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    seed = seed * 1103515245 + 12345;
+                    auto val = static_cast<uint8_t>(seed >> 16);
+                    CPU::frame_cycles = cycle + channel * 8;
+
+                    switch (channel)
+                    {
+                    case 0: dac.OutputLeft(val); break;
+                    case 1: dac.OutputRight(val); break;
+                    case 2: dac.OutputLeft2(val); break;
+                    case 3: dac.OutputRight2(val); break;
+                    }
+                }
+            }
+
+            CPU::frame_cycles = CPU_CYCLES_PER_FRAME;
+            dac.FrameEnd();
+        }
+
+        times[quality] = std::chrono::duration<double, std::micro>(
+            std::chrono::high_resolution_clock::now() - start_time).count() / bench_frames;
+    }
+
+    SetOption(dacquality, saved_quality);
+    CPU::frame_cycles = saved_frame_cycles;
+
+    // Normal quality is the original BlipBuffer synthesis, so the others are compared to it
+    auto report = fmt::format("DAC benchmark: {} frames of 4 channels at {:.0f}Hz, output at {}Hz\n",
+        bench_frames, static_cast<double>(CPU_CLOCK_HZ) / write_cycles, Sound::SampleFreq());
+    auto normal_time = times[static_cast<size_t>(SynthQuality::Normal)];
+
+    for (size_t quality = 0; quality < quality_names.size(); ++quality)
+    {
+        report += fmt::format("  {:<7} {:6.1f}us per frame ({:.2f}x normal)\n",
+            quality_names[quality], times[quality], times[quality] / normal_time);
+    }
+
+    return report;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
-void BeeperDevice::Out(uint16_t /*wPort_*/, uint8_t bVal_)
+BeeperDevice::BeeperDevice(int sample_freq) :
+    SoundDevice(sample_freq)
 {
-    if (pDAC)
-        pDAC->Output((bVal_ & BORDER_BEEP_MASK) ? 0x30 : 0x00);
+    m_buf.clock_rate(CPU_CLOCK_HZ);
+    m_buf.set_sample_rate(sample_freq);
+    m_synth.output(&m_buf);
+    m_synth.volume(1.0);
+
+    m_config.Update();
+    m_config.Apply(m_buf, { &m_synth });
 }
 
-////////////////////////////////////////////////////////////////////////////////
+void BeeperDevice::Out(uint16_t /*wPort_*/, uint8_t bVal_)
+{
+    uint8_t level = (bVal_ & BORDER_BEEP_MASK) ? 0x30 : 0x00;
+    if (level != m_level)
+    {
+        m_synth.update(CPU::frame_cycles, level);
+        m_level = level;
+        m_used = true;
+    }
+}
 
-// Basic audio mixing
-static void MixAudio(uint8_t* pDst_, const uint8_t* pSrc_, int nLen_)
+void BeeperDevice::FrameEnd()
 {
-    for (nLen_ /= 2; nLen_-- > 0; pSrc_ += 2, pDst_ += 2)
+    m_buf.end_frame(CPU_CYCLES_PER_FRAME);
+    if (m_config.Update())
+        m_config.Apply(m_buf, { &m_synth });
+
+    m_samples_this_frame = static_cast<int>(m_buf.samples_avail());
+
+    if (m_silent)
     {
-        // Add two 16-bit samples
-        short s1 = (pSrc_[1] << 8) | pSrc_[0];
-        short s2 = (pDst_[1] << 8) | pDst_[0];
-        int samp = s1 + s2;
-
-        // Clip to signed range
-        samp = std::min(samp, 32767);
-        samp = std::max(-32768, samp);
-
-        // Write new sample
-        pDst_[0] = samp & 0xff;
-        pDst_[1] = samp >> 8;
+        m_buf.remove_samples(m_samples_this_frame);
+        memset(m_sample_buffer.data(), 0, m_samples_this_frame * BYTES_PER_SAMPLE);
+        return;
     }
+
+    // Read the mono samples into the left channel, then duplicate to the right
+    auto ps = reinterpret_cast<blip_sample_t*>(m_sample_buffer.data());
+    m_buf.read_samples(ps, m_samples_this_frame, 1);
+
+    for (int i = 0; i < m_samples_this_frame; i++, ps += 2)
+        ps[1] = ps[0];
 }
 
+////////////////////////////////////////////////////////////////////////////////
 
-// Scale audio data to fit the current emulator speed setting
-static int AdjustSpeed(uint8_t* pb_, int nSize_, int nSpeed_)
+// Parse the declarative mix graph settings, in the form: name=gain[/pan],...
+static void UpdateMixNodes()
 {
-    // Limit speed range
-    nSpeed_ = std::max(nSpeed_, 50);
-    nSpeed_ = std::min(nSpeed_, 1000);
+    if (GetOption(mixer) == mix_config)
+        return;
 
-    // Slow?
-    if (nSpeed_ < 100)
+    mix_config = GetOption(mixer);
+
+    for (auto& node : mix_nodes)
     {
-        auto pdwS = reinterpret_cast<uint32_t*>(pb_ + nSize_) - 1;
-        auto pdwD = reinterpret_cast<uint32_t*>(pb_ + nSize_ * 2) - 1;
+        node.gain = 100;
+        node.pan = 0;
+    }
 
-        // Double samples in reverse order
-        for (int i = 0; i < nSize_; i += BYTES_PER_SAMPLE, pdwS--)
+    for (auto& entry : split(mix_config, ','))
+    {
+        auto fields = split(entry, '=');
+        if (fields.size() != 2)
+            continue;
+
+        auto name = tolower(trim(fields[0]));
+        auto it = std::find_if(mix_nodes.begin(), mix_nodes.end(),
+            [&](const MixNode& node) { return node.name == name; });
+        if (it == mix_nodes.end())
         {
-            *pdwD-- = *pdwS;
-            *pdwD-- = *pdwS;
+            TRACE("Unknown mixer device: {}\n", fields[0]);
+            continue;
         }
 
-        nSize_ *= 2;
+        try
+        {
+            auto values = split(fields[1], '/');
+            it->gain = std::clamp(std::stoi(values.at(0)), 0, MAX_MIX_GAIN);
+            if (values.size() > 1)
+                it->pan = std::clamp(std::stoi(values[1]), -100, 100);
+        }
+        catch (...)
+        {
+            TRACE("Invalid mixer setting: {}\n", entry);
+        }
     }
-    else if (nSpeed_ == 100)
+}
+
+// Accumulate device samples into the mix buffer, applying the node gain and pan
+static void MixDevice(const uint8_t* pb, const MixNode& node, int num_samples)
+{
+    if (!node.gain)
+        return;
+
+    int32_t gain = (node.gain << MIX_GAIN_BITS) / 100;
+    int32_t gain_left = gain * std::min(100, 100 - node.pan) / 100;
+    int32_t gain_right = gain * std::min(100, 100 + node.pan) / 100;
+
+    // Simple fixed-point loops, which the compiler is able to vectorise
+    auto ps = reinterpret_cast<const int16_t*>(pb);
+    auto pd = mix_buffer.data();
+    for (int i = 0; i < num_samples * SAMPLE_CHANNELS; i += SAMPLE_CHANNELS)
     {
-        // Nothing to do
+        pd[i] += ps[i] * gain_left;
+        pd[i + 1] += ps[i + 1] * gain_right;
     }
-    // Fast?
-    else if (nSpeed_ > 100)
+}
+
+// Convert the mix buffer back to 16-bit samples, with a single clip to the signed range
+static void ClampMix(uint8_t* pb_, int num_samples)
+{
+    auto pd = reinterpret_cast<int16_t*>(pb_);
+    auto ps = mix_buffer.data();
+    for (int i = 0; i < num_samples * SAMPLE_CHANNELS; i++)
+        pd[i] = static_cast<int16_t>(std::clamp(ps[i] >> MIX_GAIN_BITS, -32768, 32767));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+constexpr int PITCH_CHECK_FRAMES = 60;          // frames rendered per device
+constexpr int PITCH_CHECK_SKIP_FRAMES = 10;     // initial frames ignored, while output settles
+constexpr double PITCH_CHECK_TONE = 1000.0;     // test tone frequency in Hz
+constexpr double PITCH_CHECK_TOLERANCE = 0.005; // allowed relative pitch error
+
+// Frequency of a tone from its rising zero crossings, interpolated between samples.
+// Hysteresis of a quarter of the peak level ignores any ringing near the edges.
+static double ToneFrequency(const std::vector<int16_t>& samples, int sample_freq)
+{
+    if (samples.empty())
+        return 0.0;
+
+    auto mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    double peak = 0.0;
+    for (auto sample : samples)
+        peak = std::max(peak, std::abs(sample - mean));
+
+    auto threshold = peak / 4;
+    double first = -1.0, last = -1.0;
+    int crossings = 0;
+    bool armed = false;
+
+    for (size_t i = 1; i < samples.size(); ++i)
     {
-        int nScale = nSpeed_ / 100;
-        nSize_ = (nSize_ / nScale) & ~(BYTES_PER_SAMPLE - 1);
+        auto prev = samples[i - 1] - mean, curr = samples[i] - mean;
+        if (curr < -threshold)
+            armed = true;
+        else if (armed && prev < 0 && curr >= 0)
+        {
+            last = (i - 1) + prev / (prev - curr);
+            if (first < 0)
+                first = last;
+            crossings++;
+            armed = false;
+        }
+    }
 
-        auto pdwS = reinterpret_cast<uint32_t*>(pb_);
-        auto pdwD = pdwS;
+    return (crossings > 1) ? (crossings - 1) * sample_freq / (last - first) : 0.0;
+}
 
-        // Skip the required number of samples
-        for (int i = 0; i < nSize_; i += BYTES_PER_SAMPLE, pdwS += nScale)
-            *pdwD++ = *pdwS;
+// Fundamental frequency of voiced speech, from the peak autocorrelation in the 60-400Hz range
+static double VoiceFrequency(const std::vector<int16_t>& samples, int sample_freq)
+{
+    auto min_lag = sample_freq / 400, max_lag = sample_freq / 60;
+    if (samples.size() <= static_cast<size_t>(max_lag) * 2)
+        return 0.0;
+
+    auto correlate = [&](int lag)
+    {
+        double sum = 0.0;
+        for (size_t i = 0; i + lag < samples.size(); ++i)
+            sum += static_cast<double>(samples[i]) * samples[i + lag];
+        return sum / (samples.size() - lag);
+    };
+
+    std::vector<double> corr(max_lag + 2);
+    for (int lag = min_lag - 1; lag <= max_lag + 1; ++lag)
+        corr[lag] = correlate(lag);
+
+    auto best = std::max_element(corr.begin() + min_lag, corr.begin() + max_lag + 1) - corr.begin();
+    if (corr[best] <= 0.0)
+        return 0.0;
+
+    // Parabolic interpolation around the peak, for a fractional period
+    auto a = corr[best - 1], b = corr[best], c = corr[best + 1];
+    auto denom = a - 2 * b + c;
+    auto offset = (denom != 0.0) ? 0.5 * (a - c) / denom : 0.0;
+    return sample_freq / (best + offset);
+}
+
+// Render a test tone through each sound device at each supported output rate,
+// checking the measured pitch. Devices are created for each rate in turn, timed
+// from their own DAC, with the live devices untouched.
+std::string Sound::PitchCheck()
+{
+    static constexpr std::array<int, 3> rates{ 44100, 48000, 96000 };
+    static constexpr uint8_t saa_note = 11;     // 8MHz/512 * 2^octave / (511-note) = 1000Hz in octave 5
+    static constexpr uint16_t sid_freq = 17029; // 1000Hz from the PAL clock
+    static constexpr uint8_t voicebox_aa = 24;  // AA vowel allophone
+
+    auto saved_frame_cycles = CPU::frame_cycles;
+    auto report = fmt::format("Pitch check: {}Hz tones (SID {:.1f}Hz), with VoiceBox pitch relative to {}Hz\n",
+        PITCH_CHECK_TONE, sid_freq * static_cast<double>(SID_CLOCK_PAL) / (1 << 24), rates[0]);
+    auto passed = true;
+    double voice_reference = 0.0;
+
+    for (auto rate : rates)
+    {
+        DAC dac(rate);
+        BeeperDevice beeper(rate);
+        SAADevice saa(dac);
+        SIDDevice sid(dac);
+        VoiceBoxDevice voicebox(dac);
+
+        // Render frames through a device, returning the settled left channel samples.
+        // The callback issues writes for the frame, at the absolute cycle time given.
+        auto render = [&](SoundDevice& device, const std::function<void(uint64_t, uint64_t)>& frame_writes)
+        {
+            std::vector<int16_t> samples;
+            for (int frame = 0; frame < PITCH_CHECK_FRAMES; ++frame)
+            {
+                auto frame_start = static_cast<uint64_t>(frame) * CPU_CYCLES_PER_FRAME;
+                CPU::frame_cycles = 0;
+                frame_writes(frame_start, frame_start + CPU_CYCLES_PER_FRAME);
+
+                CPU::frame_cycles = CPU_CYCLES_PER_FRAME;
+                if (&device != &dac)
+                    dac.FrameEnd();
+                device.FrameEnd();
+                if (auto deferred = dynamic_cast<DeferredSoundDevice*>(&device))
+                    deferred->Sync();
+
+                // VoiceBox clears its count at the frame end, so use the DAC count as the mixer does
+                auto ps = reinterpret_cast<const int16_t*>(device.GetSampleBuffer());
+                auto count = (&device == &voicebox) ? dac.GetSampleCount() : device.GetSampleCount();
+                if (frame >= PITCH_CHECK_SKIP_FRAMES)
+                {
+                    for (int i = 0; i < count; ++i)
+                        samples.push_back(ps[i * SAMPLE_CHANNELS]);
+                }
+            }
+            return samples;
+        };
+
+        // Square wave edges at each half period of the test tone
+        auto square_edges = [&](uint64_t start, uint64_t end, const std::function<void(uint8_t)>& output)
+        {
+            auto half_period = static_cast<uint64_t>(CPU_CLOCK_HZ / PITCH_CHECK_TONE / 2);
+            for (auto edge = (start + half_period - 1) / half_period; edge * half_period < end; ++edge)
+            {
+                CPU::frame_cycles = static_cast<uint32_t>(edge * half_period - start);
+                output((edge & 1) ? 0xc0 : 0x40);
+            }
+        };
+
+        // Device name, measured frequency and expected frequency
+        std::vector<std::tuple<const char*, double, double>> results;
+
+        results.emplace_back("DAC", ToneFrequency(render(dac, [&](uint64_t start, uint64_t end) {
+            square_edges(start, end, [&](uint8_t val) { dac.Output(val); }); }), rate), PITCH_CHECK_TONE);
+
+        results.emplace_back("beeper", ToneFrequency(render(beeper, [&](uint64_t start, uint64_t end) {
+            square_edges(start, end, [&](uint8_t val) { beeper.Out(0, (val & 0x80) ? BORDER_BEEP_MASK : 0); }); }), rate), PITCH_CHECK_TONE);
+
+        results.emplace_back("SAA", ToneFrequency(render(saa, [&](uint64_t start, uint64_t) {
+            if (start)
+                return;
+
+            // Channel 0 at full volume, with its tone enabled
+            for (auto [reg, val] : std::initializer_list<std::pair<uint8_t, uint8_t>>{
+                { 0x00, 0xff }, { 0x08, saa_note }, { 0x10, 0x05 }, { 0x14, 0x01 }, { 0x15, 0x00 }, { 0x18, 0x00 }, { 0x1c, 0x01 } })
+            {
+                saa.Out(SAA_ADDR_PORT, reg);
+                saa.Out(SAA_DATA, val);
+            }
+        }), rate), PITCH_CHECK_TONE);
+
+        results.emplace_back("SID", ToneFrequency(render(sid, [&](uint64_t start, uint64_t) {
+            if (start)
+                return;
+
+            // Voice 1 triangle wave, gated with full sustain, at full volume
+            for (auto [reg, val] : std::initializer_list<std::pair<uint8_t, uint8_t>>{
+                { 0x00, sid_freq & 0xff }, { 0x01, sid_freq >> 8 }, { 0x05, 0x00 }, { 0x06, 0xf0 }, { 0x18, 0x0f }, { 0x04, 0x11 } })
+            {
+                sid.Out(static_cast<uint16_t>((reg << 8) | SID_PORT), val);
+            }
+        }), rate), sid_freq * static_cast<double>(SID_CLOCK_PAL) / (1 << 24));
+
+        if (GetOption(voicebox))
+        {
+            // Keep the allophone queue fed, so the vowel continues throughout
+            auto freq = VoiceFrequency(render(voicebox, [&](uint64_t, uint64_t) {
+                if (!(voicebox.In(BA_VOICEBOX_PORT) & 1))
+                    voicebox.Out(BA_VOICEBOX_PORT, voicebox_aa); }), rate);
+
+            if (!voice_reference)
+                voice_reference = freq;
+
+            results.emplace_back("VoiceBox", freq, voice_reference);
+        }
+
+        report += fmt::format("  {}Hz:", rate);
+        for (auto& [name, freq, expected] : results)
+        {
+            auto ok = expected > 0.0 && std::abs(freq / expected - 1.0) <= PITCH_CHECK_TOLERANCE;
+            report += fmt::format(" {} {:.1f}{}", name, freq, ok ? "" : " (FAIL)");
+            passed &= ok;
+        }
+        report += "\n";
     }
 
-    return nSize_;
+    CPU::frame_cycles = saved_frame_cycles;
+
+    report += passed ? "All devices correctly pitched" : "Pitch errors found";
+    return report;
 }
@@ -25,11 +25,10 @@
 
 #include "SAASound.h"
 
-constexpr auto SAMPLE_FREQ = 44100;
+constexpr auto DEFAULT_SAMPLE_FREQ = 44100;
 constexpr auto SAMPLE_BITS = 16;
 constexpr auto SAMPLE_CHANNELS = 2;
 constexpr auto BYTES_PER_SAMPLE = SAMPLE_BITS * SAMPLE_CHANNELS / 8;
-constexpr auto SAMPLES_PER_FRAME = SAMPLE_FREQ / EMULATED_FRAMES_PER_SECOND;
 
 
 class Sound
@@ -38,55 +37,180 @@ public:
     static bool Init();
     static void Exit();
     static void FrameUpdate(bool turbo);
+    static void RenderAhead();
+    static std::string GetStatsText();
+    static std::string PitchCheck();
+
+    static int SampleFreq();
+    static int SamplesPerFrame() { return SampleFreq() / EMULATED_FRAMES_PER_SECOND; }
 };
 
+class DAC;
+
 class SoundDevice : public IoDevice
 {
 public:
-    SoundDevice()
+    explicit SoundDevice(int sample_freq) : m_sample_freq(sample_freq)
     {
-        int nSamplesPerFrame = (SAMPLE_FREQ / EMULATED_FRAMES_PER_SECOND) + 1;
+        int nSamplesPerFrame = sample_freq / EMULATED_FRAMES_PER_SECOND + 1;
         m_sample_buffer.resize(nSamplesPerFrame * BYTES_PER_SAMPLE);
     }
 
+    int SampleFreq() const { return m_sample_freq; }
     int GetSampleCount() const { return m_samples_this_frame; }
     const uint8_t* GetSampleBuffer() const { return m_sample_buffer.data(); }
+    void SetSilent(bool silent) { m_silent = silent; }
 
 protected:
+    int m_sample_freq = 0;
     int m_samples_this_frame = 0;
     std::vector<uint8_t> m_sample_buffer;
+    bool m_silent = false;      // output not consumed, so skip waveform generation?
+};
+
+
+// Single job worker thread, used to overlap sound synthesis with emulation
+class SoundWorker
+{
+public:
+    SoundWorker() = default;
+    SoundWorker(const SoundWorker&) = delete;
+    void operator= (const SoundWorker&) = delete;
+    ~SoundWorker();
+
+    void Start(std::function<void()> job);
+    void Wait();
+    bool IsBusy();
+
+protected:
+    void ThreadProc();
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::function<void()> m_job;
+    bool m_busy = false;
+    bool m_exit = false;
+};
+
+// Register write or chip operation, timestamped with the sample position in the frame
+enum class SoundOp : uint8_t { Write, Reset, Config };
+
+struct SoundWrite
+{
+    int sample_pos;     // DAC sample position at the time of the write
+    bool reset;         // CPU reset asserted (no chip clock) up to this point?
+    SoundOp op;
+    uint16_t port;
+    uint8_t val;
+};
+
+// Sound chip with synthesis driven from a log of timestamped writes. In threaded
+// mode the log is rendered by a worker thread in slices during the frame, with the
+// remainder finished at the frame end. Sync() must be called after FrameEnd() to
+// collect the frame output, before using GetSampleBuffer(). Sample positions come
+// from the given DAC, with output at its sample rate.
+class DeferredSoundDevice : public SoundDevice
+{
+public:
+    explicit DeferredSoundDevice(const DAC& clock);
+
+    void Out(uint16_t wPort_, uint8_t bVal_) override;
+    void FrameEnd() override;
+
+    bool IsUsed() const { return m_used; }
+    void RenderAhead();
+    void Sync();
+    std::chrono::microseconds TakeSynthTime() { return std::chrono::microseconds(m_synth_us.exchange(0)); }
+
+protected:
+    void Queue(SoundOp op, uint16_t port = 0, uint8_t val = 0);
+    void Render(const std::vector<SoundWrite>& writes, bool silent, int end_pos = -1, bool end_reset = false);
+
+    virtual void Generate(uint8_t* pb, int samples) = 0;
+    virtual void Apply(const SoundWrite& write) = 0;
+
+protected:
+    const DAC& m_clock;
+    bool m_threaded = false;
+    bool m_used = false;
+    std::vector<SoundWrite> m_writes;           // pending writes for the current frame
+    std::vector<SoundWrite> m_render_writes;    // writes being rendered by the worker
+    std::vector<uint8_t> m_render_buffer;
+    int m_render_pos = 0;
+    int m_render_samples = 0;
+    bool m_frame_pending = false;
+    std::atomic<int64_t> m_synth_us{ 0 };      // synthesis time since last taken
+    SoundWorker m_worker;
 };
 
 
 struct CSAASoundDeleter { void operator()(LPCSAASOUND saasound) { DestroyCSAASound(saasound); } };
 using unique_saasound = unique_resource<LPCSAASOUND, nullptr, CSAASoundDeleter>;
 
-class SAADevice final : public SoundDevice
+class SAADevice final : public DeferredSoundDevice
 {
 public:
-    SAADevice()
+    explicit SAADevice(const DAC& clock) : DeferredSoundDevice(clock)
     {
         m_pSAASound = CreateCSAASound();
         m_pSAASound->SetSoundParameters(SAAP_NOFILTER | SAAP_16BIT | SAAP_STEREO);
-        m_pSAASound->SetSampleRate(SAMPLE_FREQ);
+        m_pSAASound->SetSampleRate(m_sample_freq);
         static_assert(SAMPLE_BITS == 16 && SAMPLE_CHANNELS == 2, "SAA parameter mismatch");
     }
+    ~SAADevice() { Sync(); }
 
 public:
-    void Update(bool fFrameEnd_);
     void FrameEnd() override;
 
-    void Out(uint16_t wPort_, uint8_t bVal_) override;
+protected:
+    void Generate(uint8_t* pb, int samples) override;
+    void Apply(const SoundWrite& write) override;
 
 protected:
     unique_saasound m_pSAASound;
+    bool m_highpass = false;
+};
+
+
+// Band-limited step synthesis at a selectable quality, for the DAC and beeper
+// outputs. The fast tier uses a linear-interpolated step rather than a kernel.
+enum class SynthQuality { Fast, Normal, High };
+
+class StepSynth
+{
+public:
+    void output(Blip_Buffer* buf);
+    void volume(double v);
+    void treble_eq(const blip_eq_t& eq);
+    void set_quality(SynthQuality quality) { m_quality = quality; }
+    void update(blip_time_t time, int amp);
+
+protected:
+    SynthQuality m_quality = SynthQuality::Normal;
+    Blip_Buffer* m_buf = nullptr;
+    int m_last_amp = 0;
+    Blip_Linear_Synth<256> m_fast{};
+    Blip_Synth<blip_med_quality, 256> m_med{};
+    Blip_Synth<blip_high_quality, 256> m_high{};
+};
+
+// Output stage settings shared by the DAC and beeper, applied when the options change
+struct SynthConfig
+{
+    int quality = -1;
+    int highpass = -1;
+    int lowpass = -1;
+
+    bool Update();
+    void Apply(Blip_Buffer& buf, std::initializer_list<StepSynth*> synths) const;
 };
 
 
 class DAC final : public SoundDevice
 {
 public:
-    DAC();
+    explicit DAC(int sample_freq);
 
 public:
     void Reset() override;
@@ -100,20 +224,39 @@ public:
     void Output(uint8_t bVal_);
     void Output2(uint8_t bVal_);
 
-    int GetSamplesSoFar();
+    int GetSamplesSoFar() const;
+
+    static std::string Benchmark();
 
 protected:
+    void Configure();
+
     Blip_Buffer buf_left{}, buf_right{};
-    Blip_Synth<blip_med_quality, 256> synth_left{}, synth_right{}, synth_left2{}, synth_right2{};
+    StepSynth synth_left{}, synth_right{}, synth_left2{}, synth_right2{};
+    SynthConfig m_config{};
 };
 
 // Spectrum-style BEEPer
-class BeeperDevice final : public IoDevice
+class BeeperDevice final : public SoundDevice
 {
+public:
+    explicit BeeperDevice(int sample_freq);
+
 public:
     void Out(uint16_t wPort_, uint8_t bVal_) override;
+    void FrameEnd() override;
+
+    bool IsUsed() const { return m_used; }
+
+protected:
+    Blip_Buffer m_buf{};
+    StepSynth m_synth{};
+    SynthConfig m_config{};
+    uint8_t m_level = 0;
+    bool m_used = false;
 };
 
 
 extern std::unique_ptr<SAADevice> pSAA;
 extern std::unique_ptr<DAC> pDAC;
+extern std::unique_ptr<BeeperDevice> pBeeper;
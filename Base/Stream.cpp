@@ -22,6 +22,69 @@
 #include "Stream.h"
 
 #include "Disk.h"
+#include "Options.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& filepath)
+{
+#ifdef _WIN32
+    auto file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER size{};
+    HANDLE mapping{};
+    void* view{};
+
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0 &&
+        (mapping = CreateFileMapping(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr)))
+    {
+        view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+
+    CloseHandle(file);
+
+    if (!view)
+        return nullptr;
+
+    return std::unique_ptr<MappedFile>(
+        new MappedFile(static_cast<uint8_t*>(view), static_cast<size_t>(size.QuadPart)));
+#else
+    auto fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st {};
+    void* view = MAP_FAILED;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if (view == MAP_FAILED)
+        return nullptr;
+
+    return std::unique_ptr<MappedFile>(
+        new MappedFile(static_cast<uint8_t*>(view), static_cast<size_t>(st.st_size)));
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+#else
+    munmap(m_data, m_size);
+#endif
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -38,6 +101,25 @@ Stream::Open(const std::string& file_path, bool read_only)
     if (file_path.empty())
         return nullptr;
 
+#ifdef HAVE_LIBZ
+    if (!GetOption(diskcache).empty())
+    {
+        if (auto stream = CacheStream::Open(file_path, read_only))
+            return stream;
+    }
+#endif
+
+    return OpenFile(file_path, read_only);
+}
+
+std::unique_ptr<Stream>
+Stream::OpenFile(const std::string& file_path, bool read_only)
+{
+    std::error_code ec;
+    if (fs::is_directory(file_path, ec))
+        return std::make_unique<DirStream>(file_path, read_only);
+
+
 #ifdef _WIN32
     if (FloppyStream::IsRecognised(file_path))
         return std::make_unique<FloppyStream>(file_path, read_only);
@@ -161,6 +243,21 @@ size_t FileStream::Write(const void* buffer, size_t len)
     return m_file ? fwrite(buffer, 1, len, m_file) : 0U;
 }
 
+std::unique_ptr<MappedFile> FileStream::Map()
+{
+    return MappedFile::Open(m_path);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+DirStream::DirStream(const std::string& dirpath, bool read_only)
+    : Stream(dirpath, read_only)
+{
+    // Name the directory itself, even with a trailing separator
+    fs::path path = dirpath;
+    m_short_name = (path.has_filename() ? path : path.parent_path()).filename().string();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 MemStream::MemStream(const std::vector<uint8_t>& file_data)
@@ -296,4 +393,239 @@ size_t ZipStream::Write(const void*, size_t)
     return 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+const std::array<uint8_t, 4> ZIP_SIGNATURE{ 'P', 'K', 0x03, 0x04 };
+
+std::unique_ptr<Stream> CacheStream::Open(const std::string& file_path, bool read_only)
+{
+    // Only compressed files benefit from caching
+    auto compressed = MappedFile::Open(file_path);
+    if (!compressed)
+        return nullptr;
+
+    auto data = compressed->Data();
+    auto is_zip = data.size() >= ZIP_SIGNATURE.size() &&
+        std::equal(ZIP_SIGNATURE.begin(), ZIP_SIGNATURE.end(), data.begin());
+    auto is_gz = data.size() >= GZ_SIGNATURE.size() &&
+        std::equal(GZ_SIGNATURE.begin(), GZ_SIGNATURE.end(), data.begin());
+    if (!is_zip && !is_gz)
+        return nullptr;
+
+    // 64-bit FNV-1a hash of the compressed contents, file size and modification time.
+    // This reads the whole compressed file on every open, but is still much cheaper
+    // than the decompression it avoids.
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto mix = [&](uint8_t b) { hash = (hash ^ b) * 0x100000001b3ULL; };
+    for (auto b : data)
+        mix(b);
+
+    std::error_code ec;
+    auto mtime = fs::last_write_time(file_path, ec).time_since_epoch().count();
+    for (auto value : { static_cast<uint64_t>(data.size()), static_cast<uint64_t>(mtime) })
+    {
+        for (int i = 0; i < 8; ++i)
+            mix(static_cast<uint8_t>(value >> (i * 8)));
+    }
+    compressed.reset();
+
+    // Match the write access of the uncached stream, with zip archives always read-only
+    unique_FILE file = fopen(file_path.c_str(), "r+b");
+    read_only |= !file || is_zip;
+    file.reset();
+
+    fs::path cache_dir = GetOption(diskcache);
+    auto stream = std::make_unique<CacheStream>(file_path, cache_dir / fmt::format("{:016x}", hash), read_only);
+    auto image_path = stream->m_entry_path.string() + ".img";
+
+    if (stream->LoadInfo() && (stream->m_data = MappedFile::Open(image_path)))
+        return stream;
+
+    // Cache miss, so decompress the source into a new entry
+    auto source = OpenFile(file_path, read_only);
+    if (!source)
+        return nullptr;
+
+    std::vector<uint8_t> image;
+    std::array<uint8_t, 0x10000> buffer;
+    for (size_t len; (len = source->Read(buffer.data(), buffer.size())) > 0; )
+        image.insert(image.end(), buffer.begin(), buffer.begin() + len);
+
+    stream->m_short_name = source->GetName();
+    source.reset();
+
+    // Write to a unique temporary file and rename it, as other instances may share the cache
+    fs::create_directories(cache_dir, ec);
+    auto temp_path = fmt::format("{}.{:08x}.tmp", image_path, std::random_device{}());
+    {
+        std::ofstream ofs(temp_path, std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(image.data()), image.size());
+        if (!ofs.flush())
+        {
+            ofs.close();
+            fs::remove(temp_path, ec);
+            return nullptr;
+        }
+    }
+
+    fs::rename(temp_path, image_path, ec);
+    if (ec || !(stream->m_data = MappedFile::Open(image_path)))
+    {
+        fs::remove(temp_path, ec);
+        return nullptr;
+    }
+
+    stream->SaveInfo();
+    stream->RemoveStale();
+    return stream;
+}
+
+CacheStream::CacheStream(const std::string& filepath, const fs::path& entry_path, bool read_only)
+    : Stream(filepath, read_only), m_entry_path(entry_path)
+{
+}
+
+// Entry details are held as name=value lines in a companion .inf file
+bool CacheStream::LoadInfo()
+{
+    std::ifstream ifs(m_entry_path.string() + ".inf");
+    if (!ifs)
+        return false;
+
+    bool have_name = false;
+    for (std::string line; std::getline(ifs, line); )
+    {
+        if (line.rfind("name=", 0) == 0)
+        {
+            m_short_name = line.substr(5);
+            have_name = !m_short_name.empty();
+        }
+        else if (line.rfind("type=", 0) == 0)
+        {
+            m_type = std::atoi(line.c_str() + 5);
+        }
+    }
+
+    return have_name;
+}
+
+void CacheStream::SaveInfo()
+{
+    auto info_path = m_entry_path.string() + ".inf";
+    auto temp_path = fmt::format("{}.{:08x}.tmp", info_path, std::random_device{}());
+    {
+        std::ofstream ofs(temp_path);
+        ofs << "name=" << m_short_name << '\n';
+        ofs << "path=" << m_path << '\n';
+        if (m_type)
+            ofs << "type=" << *m_type << '\n';
+    }
+
+    std::error_code ec;
+    fs::rename(temp_path, info_path, ec);
+    if (ec)
+        fs::remove(temp_path, ec);
+}
+
+// Remove older entries for the same source path, left behind when its contents changed
+void CacheStream::RemoveStale()
+{
+    std::error_code ec;
+    for (auto& entry : fs::directory_iterator(m_entry_path.parent_path(), ec))
+    {
+        auto entry_path = entry.path();
+        if (entry_path.extension() != ".inf" || entry_path.stem() == m_entry_path.filename())
+            continue;
+
+        std::ifstream ifs(entry_path);
+        for (std::string line; std::getline(ifs, line); )
+        {
+            if (line.rfind("path=", 0) == 0)
+            {
+                if (line.substr(5) == m_path)
+                {
+                    ifs.close();
+                    fs::remove(entry_path, ec);
+                    fs::remove(entry_path.replace_extension(".img"), ec);
+                }
+                break;
+            }
+        }
+    }
+}
+
+void CacheStream::SetCachedType(int type)
+{
+    if (!m_source && m_type != type)
+    {
+        m_type = type;
+        SaveInfo();
+    }
+}
+
+size_t CacheStream::GetSize()
+{
+    if (m_source)
+        return m_source->GetSize();
+
+    return m_data ? m_data->Data().size() : 0U;
+}
+
+void CacheStream::Close()
+{
+    if (m_source)
+        m_source->Close();
+
+    m_mode = FileMode::Closed;
+}
+
+void CacheStream::Rewind()
+{
+    if (m_source)
+        m_source->Rewind();
+
+    m_pos = 0;
+}
+
+size_t CacheStream::Read(void* buffer, size_t len)
+{
+    if (m_source)
+        return m_source->Read(buffer, len);
+    else if (!m_data)
+        return 0;
+
+    auto data = m_data->Data();
+    len = std::min(len, data.size() - std::min(m_pos, data.size()));
+    std::memcpy(buffer, data.data() + m_pos, len);
+    m_pos += len;
+    return len;
+}
+
+size_t CacheStream::Write(const void* buffer, size_t len)
+{
+    if (m_read_only)
+        return 0;
+
+    // Writes go to the original file, leaving the cache entry stale
+    if (!m_source)
+    {
+        m_data.reset();
+        m_type.reset();
+
+        std::error_code ec;
+        fs::remove(m_entry_path.string() + ".inf", ec);
+        fs::remove(m_entry_path.string() + ".img", ec);
+
+        if (!(m_source = OpenFile(m_path, m_read_only)))
+            return 0;
+    }
+
+    return m_source->Write(buffer, len);
+}
+
+std::unique_ptr<MappedFile> CacheStream::Map()
+{
+    return m_source ? nullptr : MappedFile::Open(m_entry_path.string() + ".img");
+}
+
 #endif  // HAVE_LIBZ
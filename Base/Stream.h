@@ -20,6 +20,26 @@
 
 #pragma once
 
+// File contents mapped copy-on-write, so they can be modified in memory without
+// changing the file. The mapping must be released before the file is rewritten.
+class MappedFile
+{
+public:
+    static std::unique_ptr<MappedFile> Open(const std::string& filepath);
+
+    MappedFile(const MappedFile&) = delete;
+    void operator= (const MappedFile&) = delete;
+    ~MappedFile();
+
+    span<uint8_t> Data() const { return { m_data, m_size }; }
+
+protected:
+    MappedFile(uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
 class Stream
 {
 public:
@@ -38,8 +58,16 @@ public:
     virtual void Rewind() = 0;
     virtual size_t Read(void* buffer, size_t len) = 0;
     virtual size_t Write(const void* buffer, size_t len) = 0;
+    virtual std::unique_ptr<MappedFile> Map() { return nullptr; }
+    virtual bool IsRawFile() const { return false; }
+
+    // Image type detected on a previous open, for streams able to remember it
+    virtual std::optional<int> CachedType() const { return std::nullopt; }
+    virtual void SetCachedType(int /*type*/) { }
 
 protected:
+    static std::unique_ptr<Stream> OpenFile(const std::string& filepath, bool read_only);
+
     enum class FileMode { Closed, Reading, Writing };
     FileMode m_mode = FileMode::Reading;
 
@@ -58,11 +86,26 @@ public:
     void Rewind() override;
     size_t Read(void* buffer, size_t len) override;
     size_t Write(const void* buffer, size_t len) override;
+    std::unique_ptr<MappedFile> Map() override;
+    bool IsRawFile() const override { return true; }
 
 protected:
     unique_FILE m_file;
 };
 
+// Host directory, for presenting as a virtual disk
+class DirStream final : public Stream
+{
+public:
+    DirStream(const std::string& dirpath, bool read_only = false);
+
+    size_t GetSize() override { return 0; }
+    void Close() override { }
+    void Rewind() override { }
+    size_t Read(void*, size_t) override { return 0; }
+    size_t Write(const void*, size_t) override { return 0; }
+};
+
 class MemStream final : public Stream
 {
 public:
@@ -122,4 +165,36 @@ protected:
     unique_unzFile m_file;
 };
 
+// Decompressed copy of a compressed image, held in the diskcache directory and keyed
+// by a hash of the compressed contents. Writes go to the original compressed file.
+// Only the latest entry for each source path is kept, but entries for images that
+// are moved or deleted are never evicted, so the cache grows without limit.
+class CacheStream final : public Stream
+{
+public:
+    static std::unique_ptr<Stream> Open(const std::string& filepath, bool read_only);
+    CacheStream(const std::string& filepath, const fs::path& entry_path, bool read_only);
+
+    size_t GetSize() override;
+    void Close() override;
+    void Rewind() override;
+    size_t Read(void* buffer, size_t len) override;
+    size_t Write(const void* buffer, size_t len) override;
+    std::unique_ptr<MappedFile> Map() override;
+
+    std::optional<int> CachedType() const override { return m_type; }
+    void SetCachedType(int type) override;
+
+protected:
+    bool LoadInfo();
+    void SaveInfo();
+    void RemoveStale();
+
+    fs::path m_entry_path;
+    std::unique_ptr<MappedFile> m_data;
+    std::unique_ptr<Stream> m_source;
+    std::optional<int> m_type;
+    size_t m_pos = 0;
+};
+
 #endif  // HAVE_LIBZ
@@ -42,6 +42,43 @@ static std::unique_ptr<libspectrum_byte[]> pbTape;
 static bool fEar;
 static libspectrum_dword tremain = 0;
 
+// Edges are decoded a block at a time ahead of playback. Each entry holds the SAM
+// t-states until the edge is due, with the level change in the top 2 bits.
+constexpr uint32_t EDGE_TOGGLE = 0u << 30;
+constexpr uint32_t EDGE_LOW = 1u << 30;
+constexpr uint32_t EDGE_HIGH = 2u << 30;
+constexpr uint32_t EDGE_NONE = 3u << 30;
+constexpr uint32_t EDGE_TIME_MASK = (1u << 30) - 1;
+constexpr size_t TIMELINE_MAX_EDGES = 1 << 20;  // limit per decode, for long raw blocks
+
+static std::vector<uint32_t> timeline;
+static size_t timeline_pos;
+static size_t timeline_pilot_edges;     // leading edges in a ROM or turbo block pilot tone
+static int timeline_block;              // index of the block being played
+
+constexpr auto MAX_EDGE_LOOP_BYTES = 32;    // maximum distance from loop start to the port read
+constexpr auto NUM_COUNTER_REGS = 6;        // B, C, D, E, H, L
+
+// Port read state for the last pass of a custom loader edge loop
+struct EdgeLoopPass
+{
+    uint16_t pc{}, port{};
+    uint8_t val{}, r{}, r_step{};
+    uint32_t time{}, period{};
+    std::array<uint8_t, NUM_COUNTER_REGS> regs{};
+    std::array<uint64_t, 10> other_regs{};
+};
+
+static EdgeLoopPass last_pass;
+static uint64_t skipped_passes;         // edge loop passes skipped, reported by the check
+
+// Discard decoded edges, after the libspectrum tape position is changed
+static void ClearTimeline()
+{
+    timeline.clear();
+    timeline_pos = timeline_pilot_edges = 0;
+}
+
 bool IsRecognised(const std::string& filepath)
 {
     libspectrum_id_t type = LIBSPECTRUM_ID_UNKNOWN;
@@ -73,6 +110,17 @@ bool IsInserted()
     return pTape != nullptr;
 }
 
+int CurrentBlock()
+{
+    int block_idx = 0;
+    if (timeline_pos < timeline.size())
+        block_idx = timeline_block;
+    else if (pTape)
+        libspectrum_tape_position(&block_idx, pTape);
+
+    return block_idx;
+}
+
 std::string GetPath()
 {
     return tape_path;
@@ -120,6 +168,8 @@ bool Insert(const std::string& filepath)
 void Eject()
 {
     Stop();
+    ClearTimeline();
+    timeline.shrink_to_fit();
 
     if (pTape) libspectrum_tape_free(pTape), pTape = nullptr;
     pbTape.reset();
@@ -127,10 +177,64 @@ void Eject()
     tape_path.clear();
 }
 
-void NextEdge(uint32_t dwTime_)
+void SelectBlock(int block_idx)
 {
-    libspectrum_error error;
+    if (pTape)
+    {
+        libspectrum_tape_nth_block(pTape, block_idx);
+        ClearTimeline();
+    }
+}
+
+// Decode edges from the current tape position to the end of the block
+static bool DecodeEdges()
+{
+    ClearTimeline();
+    libspectrum_tape_position(&timeline_block, pTape);
+
+    // Count the pilot tone edges of blocks the loading trap accepts
+    auto block = libspectrum_tape_current_block(pTape);
+    auto type = block ? libspectrum_tape_block_type(block) : LIBSPECTRUM_TAPE_BLOCK_PAUSE;
+    auto count_pilot = type == LIBSPECTRUM_TAPE_BLOCK_ROM || type == LIBSPECTRUM_TAPE_BLOCK_TURBO;
+
+    while (timeline.size() < TIMELINE_MAX_EDGES)
+    {
+        auto pilot = count_pilot && timeline_pilot_edges == timeline.size() &&
+            libspectrum_tape_state(pTape) == LIBSPECTRUM_TAPE_STATE_PILOT;
+
+        libspectrum_dword zx_tstates{};
+        int nFlags{};
+
+        // Fetch details of the next edge, and the time until it's due
+        if (libspectrum_tape_get_next_edge(&zx_tstates, &nFlags, pTape))
+            break;
+
+        // Timings are in 3.5MHz t-states, so convert to SAM t-states
+        uint64_t tstates = static_cast<uint64_t>(zx_tstates) * (CPU_CLOCK_HZ / 100'000) + tremain;
+        auto tadd = tstates / (SPECTRUM_TSTATES_PER_SECOND / 100'000);
+        tremain = static_cast<libspectrum_dword>(tstates % (SPECTRUM_TSTATES_PER_SECOND / 100'000));
+
+        uint32_t edge = static_cast<uint32_t>(std::min<uint64_t>(tadd, EDGE_TIME_MASK));
+        if (nFlags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW)
+            edge |= EDGE_LOW;
+        else if (nFlags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH)
+            edge |= EDGE_HIGH;
+        else if (nFlags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE)
+            edge |= EDGE_NONE;
 
+        timeline.push_back(edge);
+        if (pilot)
+            timeline_pilot_edges++;
+
+        if (nFlags & (LIBSPECTRUM_TAPE_FLAGS_BLOCK | LIBSPECTRUM_TAPE_FLAGS_TAPE))
+            break;
+    }
+
+    return !timeline.empty();
+}
+
+void NextEdge(uint32_t dwTime_)
+{
     if (fEar)
         IO::State().keyboard |= KEYBOARD_EAR_MASK;
     else
@@ -139,30 +243,22 @@ void NextEdge(uint32_t dwTime_)
     if (!Frame::TurboMode())
         pDAC->Output(fEar ? 0xa0 : 0x80);
 
-    libspectrum_dword zx_tstates{};
-    int nFlags{};
-
-    // Fetch details of the next edge, and the time until it's due
-    error = libspectrum_tape_get_next_edge(&zx_tstates, &nFlags, pTape);
-    if (error)
+    if (timeline_pos == timeline.size() && !DecodeEdges())
     {
         Stop();
         return;
     }
 
-    if (nFlags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_LOW)
-        fEar = false;
-    else if (nFlags & LIBSPECTRUM_TAPE_FLAGS_LEVEL_HIGH)
-        fEar = true;
-    else if (!(nFlags & LIBSPECTRUM_TAPE_FLAGS_NO_EDGE))
-        fEar = !fEar;
+    auto edge = timeline[timeline_pos++];
 
-    // Timings are in 3.5MHz t-states, so convert to SAM t-states
-    zx_tstates = zx_tstates * (CPU_CLOCK_HZ / 100'000) + tremain;
-    auto tadd = zx_tstates / (SPECTRUM_TSTATES_PER_SECOND / 100'000);
-    tremain = zx_tstates % (SPECTRUM_TSTATES_PER_SECOND / 100'000);
+    switch (edge & ~EDGE_TIME_MASK)
+    {
+    case EDGE_LOW:      fEar = false; break;
+    case EDGE_HIGH:     fEar = true; break;
+    case EDGE_TOGGLE:   fEar = !fEar; break;
+    }
 
-    AddEvent(EventType::TapeEdge, dwTime_ + tadd);
+    AddEvent(EventType::TapeEdge, dwTime_ + (edge & EDGE_TIME_MASK));
 }
 
 void Play()
@@ -205,6 +301,19 @@ bool LoadTrap()
     if (!load_exit || !load_fail)
         return false;
 
+    // The tape has been decoded ahead of playback, so return to the block being played
+    if (timeline_pos < timeline.size())
+    {
+        // Continue playing unless we're still in the pilot tone
+        if (timeline_pos >= timeline_pilot_edges)
+        {
+            Play();
+            return false;
+        }
+
+        SelectBlock(timeline_block);
+    }
+
     // Skip over any metadata blocks
     auto block = libspectrum_tape_current_block(pTape);
     while (block && libspectrum_tape_block_metadata(block))
@@ -546,20 +655,606 @@ void InFEHook()
         if (GetOption(tapetraps) && GetOption(turbotape))
         {
             auto event_time = GetEventTime(EventType::TapeEdge);
-            auto edglp = cpu.get_pc() - 2;
 
-            // Simulate the edge code to advance to the next edge
-            // Return to normal processing if C hits 255 (no edge found) or the ear bit has changed
-            while (event_time > 48 && cpu.get_c() < 0xff && !((IO::State().keyboard ^ cpu.get_b()) & KEYBOARD_EAR_MASK))
+            // Skip the edge loop iterations (48 cycles each) up to the next edge, stopping early
+            // if C hits 255 (no edge found). Nothing is skipped if the ear bit has already changed.
+            if (event_time > 48 && !((IO::State().keyboard ^ cpu.get_b()) & KEYBOARD_EAR_MASK))
             {
-                cpu.set_c(cpu.get_c() + 1);
-                cpu.set_r((cpu.get_r() & 0x80) | ((cpu.get_r() + 7) & 0x7f));
-                CPU::frame_cycles += 48;
-                event_time -= 48;
-                cpu.set_pc(edglp);
+                auto loops = std::min<uint32_t>((event_time - 1) / 48, 0xff - cpu.get_c());
+                if (loops)
+                {
+                    cpu.set_c(static_cast<uint8_t>(cpu.get_c() + loops));
+                    cpu.set_r((cpu.get_r() & 0x80) | ((cpu.get_r() + 7 * loops) & 0x7f));
+                    CPU::frame_cycles += 48 * loops;
+                    cpu.set_pc(cpu.get_pc() - 2);
+                }
             }
         }
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Custom loaders often sample the ear bit in a tight counting loop, such as:
+//
+//   LD-SAMPLE: inc b        ; count the pass, exiting on overflow
+//              ret z
+//              ld a,&7f
+//              in a,(&fe)   ; sample the ear bit
+//              rra
+//              xor c        ; compare with the previous level
+//              and &40
+//              jr z,LD-SAMPLE
+//
+// Loops made only from simple instructions like these, with a single port read
+// and at most one counter register, are recognised from their code. Once two
+// consecutive passes have read the same value and taken the same time, with
+// only the counter changed, the CPU is moved forward by whole passes to just
+// before the next event. The counter, R and any flags taken from the counter
+// are set to what running the passes would have given. This is experimental,
+// so it's only enabled by the tapeedgeloops option.
+
+enum class FlagSource { Prior, Input, Counter };
+
+struct LoopOp
+{
+    int len = 0;
+    int counter = -1;       // register changed by INC/DEC/DJNZ (0-5 for B-L)
+    int step = 0;           // counter change
+    int reads = -1;         // register read, other than A
+    int writes = -1;        // register written with the port value, other than A
+    int cond = -1;          // branch condition (0=NZ, 1=Z, 2=NC, 3=C, 4=DJNZ), or -1 for always
+    bool branch = false;
+    bool ret = false;
+    bool in = false;
+    bool sets_szp = false;  // changes S, Z and P/V flags
+    bool sets_hnxy = false; // changes H, N and undocumented flags
+    bool sets_c = false;    // changes carry flag
+    uint16_t target = 0;
+};
+
+struct EdgeLoop
+{
+    int counter = -1;           // counter register, or -1 for none
+    int step = 0;               // counter change per pass
+    bool counter_exit = false;  // loop exits when the counter reaches zero?
+    bool counter_szp = false;   // S, Z and P/V at the port read come from the counter?
+    bool counter_hnxy = false;  // H, N and undocumented flags at the port read come from the counter?
+    uint16_t start = 0, end = 0;
+};
+
+// Decode an instruction, if it's one allowed in an edge loop
+static bool DecodeLoopOp(uint16_t addr, LoopOp& op)
+{
+    auto opcode = read_byte(addr);
+    auto reg = (opcode >> 3) & 7;
+    auto src = opcode & 7;
+    op = {};
+    op.len = 1;
+
+    if ((opcode & 0xc6) == 0x04 && reg < NUM_COUNTER_REGS)  // INC r / DEC r
+    {
+        op.counter = reg;
+        op.step = (opcode & 1) ? -1 : 1;
+        op.sets_szp = op.sets_hnxy = true;
+    }
+    else if (opcode >= 0x80 && opcode < 0xc0 && src != 6)   // ALU A,r
+    {
+        op.reads = (src != 7) ? src : -1;
+        op.sets_szp = op.sets_hnxy = op.sets_c = true;
+    }
+    else if ((opcode & 0xc7) == 0xc6)                       // ALU A,n
+    {
+        op.len = 2;
+        op.sets_szp = op.sets_hnxy = op.sets_c = true;
+    }
+    else if ((opcode & 0xe7) == 0xc0)                       // RET cc (NZ/Z/NC/C)
+    {
+        op.ret = true;
+        op.cond = reg;
+    }
+    else if ((opcode & 0xe7) == 0xc2 || opcode == 0xc3)     // JP cc,nn / JP nn
+    {
+        op.len = 3;
+        op.branch = true;
+        op.cond = (opcode == 0xc3) ? -1 : reg;
+        op.target = read_word(static_cast<uint16_t>(addr + 1));
+    }
+    else if (opcode == 0x10 || opcode == 0x18 || (opcode & 0xe7) == 0x20)   // DJNZ / JR / JR cc
+    {
+        op.len = 2;
+        op.branch = true;
+        op.cond = (opcode == 0x10) ? 4 : (opcode == 0x18) ? -1 : (reg - 4);
+        op.target = static_cast<uint16_t>(addr + 2 + static_cast<int8_t>(read_byte(static_cast<uint16_t>(addr + 1))));
+
+        if (opcode == 0x10)
+        {
+            op.counter = 0;
+            op.step = -1;
+        }
+    }
+    else if (opcode == 0xdb)                                // IN A,(n)
+    {
+        op.len = 2;
+        op.in = true;
+    }
+    else if (opcode == 0xed)                                // IN r,(C)
+    {
+        auto opcode2 = read_byte(static_cast<uint16_t>(addr + 1));
+        reg = (opcode2 >> 3) & 7;
+        if ((opcode2 & 0xc7) != 0x40)
+            return false;
+
+        op.len = 2;
+        op.in = true;
+        op.reads = 1;
+        op.writes = (reg < NUM_COUNTER_REGS) ? reg : -1;
+        op.sets_szp = op.sets_hnxy = true;
+    }
+    else if ((opcode & 0xe7) == 0x07 || opcode == 0x37 || opcode == 0x3f)  // RLCA/RRCA/RLA/RRA/SCF/CCF
+    {
+        op.sets_hnxy = op.sets_c = true;
+    }
+    else if (opcode == 0x2f)                                // CPL
+    {
+        op.sets_hnxy = true;
+    }
+    else if (opcode == 0x3e)                                // LD A,n
+    {
+        op.len = 2;
+    }
+    else if (opcode != 0x00)                                // NOP
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// Check for an edge loop around the port read ending at the given address
+static std::optional<EdgeLoop> AnalyseEdgeLoop(uint16_t in_end)
+{
+    auto in_start = static_cast<uint16_t>(in_end - 2);
+    EdgeLoop loop;
+    LoopOp op;
+
+    // Find the branch back to the start of the loop
+    for (auto addr = in_end; ; addr += op.len)
+    {
+        if (static_cast<uint16_t>(addr - in_start) > MAX_EDGE_LOOP_BYTES || !DecodeLoopOp(addr, op))
+            return std::nullopt;
+
+        if (op.branch && static_cast<uint16_t>(in_start - op.target) <= MAX_EDGE_LOOP_BYTES)
+        {
+            loop.start = op.target;
+            loop.end = static_cast<uint16_t>(addr + op.len);
+            break;
+        }
+    }
+
+    // Decode the full loop, which must pass through the port read
+    std::vector<LoopOp> ops;
+    bool found_in = false;
+    for (auto addr = loop.start; addr != loop.end; addr += op.len)
+    {
+        if (static_cast<uint16_t>(addr - loop.start) > 2 * MAX_EDGE_LOOP_BYTES || !DecodeLoopOp(addr, op))
+            return std::nullopt;
+
+        // Other branches must leave the loop
+        auto last = static_cast<uint16_t>(addr + op.len) == loop.end;
+        if (op.branch && !last && static_cast<uint16_t>(op.target - loop.start) < static_cast<uint16_t>(loop.end - loop.start))
+            return std::nullopt;
+
+        if (op.in && (addr != in_start || found_in))
+            return std::nullopt;
+        found_in |= op.in;
+
+        if (op.counter >= 0)
+        {
+            if (loop.counter >= 0)
+                return std::nullopt;
+
+            loop.counter = op.counter;
+            loop.step = op.step;
+        }
+
+        ops.push_back(op);
+    }
+
+    if (!found_in)
+        return std::nullopt;
+
+    // The counter mustn't affect anything but itself and its flags
+    for (auto& loop_op : ops)
+    {
+        if (loop.counter >= 0 && (loop_op.reads == loop.counter || loop_op.writes == loop.counter))
+            return std::nullopt;
+    }
+
+    // Trace where the flags come from, with a second pass to wrap around the loop. Branches
+    // on flags from the port value are the same each pass, but those from the counter may
+    // only test for zero.
+    auto szp = FlagSource::Prior, hnxy = FlagSource::Prior, c = FlagSource::Prior;
+    for (auto pass = 0; pass < 2; ++pass)
+    {
+        for (auto& loop_op : ops)
+        {
+            if (pass == 1 && loop_op.in)
+            {
+                loop.counter_szp = szp == FlagSource::Counter;
+                loop.counter_hnxy = hnxy == FlagSource::Counter;
+            }
+
+            if (pass == 1 && loop_op.cond == 4)
+                loop.counter_exit = true;
+            else if (pass == 1 && loop_op.cond >= 0 && ((loop_op.cond < 2) ? szp : c) == FlagSource::Counter)
+            {
+                if (loop_op.cond >= 2)
+                    return std::nullopt;
+
+                loop.counter_exit = true;
+            }
+
+            auto source = (loop_op.counter >= 0) ? FlagSource::Counter : FlagSource::Input;
+            if (loop_op.sets_szp) szp = source;
+            if (loop_op.sets_hnxy) hnxy = source;
+            if (loop_op.sets_c) c = source;
+        }
+    }
+
+    return loop;
+}
+
+// Find where regular memory contention ends, so each loop pass takes the same time
+static uint32_t UniformContentionEnd(uint32_t start, uint32_t end)
+{
+    auto matches = [](uint32_t t, int mask) { return Memory::contention_ptr[t] == mask - ((t + 2) & mask); };
+
+    auto mask = 7;
+    for (auto t = start; t < start + 8; ++t)
+    {
+        if (!matches(t, mask))
+        {
+            mask = 3;
+            break;
+        }
+    }
+
+    auto t = start;
+    while (t < end && matches(t, mask))
+        ++t;
+
+    return t;
+}
+
+static uint8_t GetCounter(int reg)
+{
+    switch (reg)
+    {
+    case 0: return cpu.get_b();
+    case 1: return cpu.get_c();
+    case 2: return cpu.get_d();
+    case 3: return cpu.get_e();
+    case 4: return cpu.get_h();
+    default: return cpu.get_l();
+    }
+}
+
+static void SetCounter(int reg, uint8_t val)
+{
+    switch (reg)
+    {
+    case 0: cpu.set_b(val); break;
+    case 1: cpu.set_c(val); break;
+    case 2: cpu.set_d(val); break;
+    case 3: cpu.set_e(val); break;
+    case 4: cpu.set_h(val); break;
+    default: cpu.set_l(val); break;
+    }
+}
+
+void EdgeLoopHook(uint16_t port, uint8_t val)
+{
+    if (!GetOption(tapeedgeloops) || !IsPlaying() || !GetOption(tapetraps) || !GetOption(turbotape) ||
+        (port >> 8) == 0xff || cpu.get_pc() == rom_hook_addr(RomHook::EDGLP))
+    {
+        return;
+    }
+
+    EdgeLoopPass pass;
+    pass.pc = static_cast<uint16_t>(cpu.get_pc());
+    pass.port = port;
+    pass.val = val;
+    pass.r = static_cast<uint8_t>(cpu.get_r());
+    pass.time = CPU::frame_cycles;
+    for (auto i = 0; i < NUM_COUNTER_REGS; ++i)
+        pass.regs[i] = GetCounter(i);
+    pass.other_regs = {
+        cpu.get_a(), cpu.get_ix(), cpu.get_iy(), cpu.get_sp(), cpu.get_i(),
+        cpu.get_alt_af(), cpu.get_alt_bc(), cpu.get_alt_de(), cpu.get_alt_hl(), cpu.get_iff1() };
+
+    auto prev = last_pass;
+    last_pass = pass;
+
+    if (pass.pc != prev.pc || pass.port != prev.port || pass.val != prev.val ||
+        pass.other_regs != prev.other_regs || pass.time <= prev.time)
+    {
+        return;
+    }
+
+    last_pass.period = pass.time - prev.time;
+    last_pass.r_step = (pass.r - prev.r) & 0x7f;
+
+    // Require two passes with the same timing, for the pattern to have settled
+    if (last_pass.period != prev.period || last_pass.r_step != prev.r_step || (last_pass.period & 7))
+        return;
+
+    // At most one register may change, counting by one in either direction
+    int counter = -1, step = 0;
+    for (auto i = 0; i < NUM_COUNTER_REGS; ++i)
+    {
+        auto diff = static_cast<uint8_t>(pass.regs[i] - prev.regs[i]);
+        if (!diff)
+            continue;
+        else if (counter >= 0 || (diff != 0x01 && diff != 0xff))
+            return;
+
+        counter = i;
+        step = (diff == 0x01) ? 1 : -1;
+    }
+
+    // Leave any active interrupt to the CPU core
+    if (cpu.get_iff1() && (IO::State().status & STATUS_INT_MASK) != STATUS_INT_MASK)
+        return;
+
+    auto loop = AnalyseEdgeLoop(pass.pc);
+    if (!loop || loop->counter != counter || loop->step != step)
+        return;
+
+    // Stop short of the next event, which includes the next tape edge
+    auto limit = std::min<uint32_t>(head_ptr->due_time, CPU_CYCLES_PER_FRAME);
+    if (afSectionContended[AddrSection(loop->start)] || afSectionContended[AddrSection(loop->end - 1)])
+        limit = UniformContentionEnd(prev.time, limit);
+
+    if (limit <= pass.time)
+        return;
+
+    auto period = last_pass.period;
+    auto passes = (limit - pass.time - 1) / period;
+
+    // Stop short of the counter exiting the loop
+    if (loop->counter_exit)
+    {
+        auto count = pass.regs[counter];
+        auto remaining = (step > 0) ? static_cast<uint8_t>(0x100 - count) : count;
+        passes = std::min<uint32_t>(passes, (remaining ? remaining : 0x100) - 1);
+    }
+
+    if (!passes)
+        return;
+
+    CPU::frame_cycles += passes * period;
+    skipped_passes += passes;
+    cpu.set_r((pass.r & 0x80) | ((pass.r + passes * last_pass.r_step) & 0x7f));
+    last_pass.time = CPU::frame_cycles;
+    last_pass.r = cpu.get_r();
+
+    if (counter >= 0)
+    {
+        auto count = static_cast<uint8_t>(pass.regs[counter] + passes * step);
+        SetCounter(counter, count);
+        last_pass.regs[counter] = count;
+
+        // Flags from an INC or DEC of the counter, leaving carry unchanged
+        uint8_t f = cpu.get_f();
+        if (loop->counter_szp)
+        {
+            f &= ~(cpu.sf_mask | cpu.zf_mask | cpu.pf_mask);
+            f |= (count & cpu.sf_mask) | (count ? 0 : cpu.zf_mask);
+            if (count == ((step > 0) ? 0x80 : 0x7f))
+                f |= cpu.pf_mask;
+        }
+
+        if (loop->counter_hnxy)
+        {
+            f &= ~(cpu.hf_mask | cpu.nf_mask | cpu.yf_mask | cpu.xf_mask);
+            f |= count & (cpu.yf_mask | cpu.xf_mask);
+            if ((count & 0x0f) == ((step > 0) ? 0x00 : 0x0f))
+                f |= cpu.hf_mask;
+            if (step < 0)
+                f |= cpu.nf_mask;
+        }
+
+        cpu.set_f(f);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Z80 registers, saved and restored around each run of the edge loop check
+static std::array<uint64_t, 17> GetRegs()
+{
+    return {
+        cpu.get_af(), cpu.get_bc(), cpu.get_de(), cpu.get_hl(), cpu.get_ix(), cpu.get_iy(),
+        cpu.get_sp(), cpu.get_pc(), cpu.get_i(), cpu.get_r(), cpu.get_alt_af(), cpu.get_alt_bc(),
+        cpu.get_alt_de(), cpu.get_alt_hl(), cpu.get_iff1(), cpu.get_iff2(), cpu.get_int_mode() };
+}
+
+static void SetRegs(const std::array<uint64_t, 17>& regs)
+{
+    cpu.set_af(regs[0]), cpu.set_bc(regs[1]), cpu.set_de(regs[2]), cpu.set_hl(regs[3]);
+    cpu.set_ix(regs[4]), cpu.set_iy(regs[5]), cpu.set_sp(regs[6]), cpu.set_pc(regs[7]);
+    cpu.set_i(regs[8]), cpu.set_r(regs[9]), cpu.set_alt_af(regs[10]), cpu.set_alt_bc(regs[11]);
+    cpu.set_alt_de(regs[12]), cpu.set_alt_hl(regs[13]), cpu.set_iff1(regs[14]), cpu.set_iff2(regs[15]);
+    cpu.set_int_mode(static_cast<unsigned>(regs[16]));
+}
+
+// Hash of the state compared between runs: registers, frame timing, I/O state and memory
+static uint64_t MachineState()
+{
+    auto regs = GetRegs();
+    auto hash = HashBlock(regs.data(), sizeof(regs), CPU::frame_cycles);
+    hash = HashBlock(&IO::State(), sizeof(IO::State()), hash);
+    return HashBlock(pMemory, TOTAL_PAGES * MEM_PAGE_SIZE, hash);
+}
+
+// Load each tape image with and without edge loop acceleration, using the
+// tape's own loaders. Each run starts from the same reset machine and types
+// LOAD "". The plain run continues until the tape has been stopped for a few
+// seconds, and the accelerated run lasts the same number of frames. The
+// machine state is compared every second, and where loading ended.
+std::string EdgeLoopCheck(const std::string& path)
+{
+    constexpr auto check_frames = EMULATED_FRAMES_PER_SECOND;
+    constexpr auto idle_frames = EMULATED_FRAMES_PER_SECOND * 5;
+    constexpr auto max_frames = EMULATED_FRAMES_PER_SECOND * 60 * 20;
+    using namespace std::chrono;
+
+    std::vector<std::string> paths;
+    std::error_code ec;
+    if (fs::is_directory(path, ec))
+    {
+        for (auto& entry : fs::directory_iterator(path, ec))
+        {
+            if (entry.is_regular_file() && IsRecognised(entry.path().string()))
+                paths.push_back(entry.path().string());
+        }
+        std::sort(paths.begin(), paths.end());
+    }
+    else
+    {
+        paths.push_back(path);
+    }
+
+    if (paths.empty())
+        return fmt::format("No tape images found:\n\n{}", path);
+
+    struct RunResult
+    {
+        std::vector<uint64_t> states;   // machine state at the end of each second
+        int frames = 0;
+        int load_end = 0;               // frame the tape last stopped
+        uint64_t load_end_state = 0;
+        uint64_t passes = 0;
+        double seconds = 0.0;
+    };
+
+    auto saved_options = Options::g_config;
+    auto saved_memory = std::vector<uint8_t>(pMemory, pMemory + TOTAL_PAGES * MEM_PAGE_SIZE);
+    auto saved_events = std::vector<CPU_EVENT>(std::begin(events), std::end(events));
+    auto saved_head = head_ptr, saved_free_head = free_head_ptr;
+    auto saved_frame_cycles = CPU::frame_cycles;
+    auto saved_regs = GetRegs();
+
+    SetOption(tapetraps, true);
+    SetOption(turbotape, true);
+    SetOption(autoload, true);
+    SetOption(autoboot, true);
+    SetOption(keyin, "");
+
+    // Run frames as CPU::Run does, without the display, returning false at the frame limit
+    auto run = [&](const std::string& tape_path, bool accelerate, int frames)
+    {
+        std::copy(saved_memory.begin(), saved_memory.end(), pMemory);
+        std::copy(saved_events.begin(), saved_events.end(), events);
+        head_ptr = saved_head, free_head_ptr = saved_free_head;
+        CPU::frame_cycles = saved_frame_cycles;
+        SetRegs(saved_regs);
+
+        SetOption(tapeedgeloops, accelerate);
+        CPU::Reset(true);
+        CPU::Reset(false);
+        last_pass = {};
+        skipped_passes = 0;
+
+        RunResult result;
+        if (!Insert(tape_path))
+            return result;
+
+        IO::QueueAutoBoot(AutoLoadType::Tape);
+        auto start_time = high_resolution_clock::now();
+        auto started = false;
+
+        while (result.frames < frames)
+        {
+            CPU::ExecuteChunk();
+
+            if (CPU::frame_cycles < CPU_CYCLES_PER_FRAME)
+                continue;
+
+            EventFrameEnd(CPU_CYCLES_PER_FRAME);
+            IO::FrameUpdate();
+            CPU::frame_cycles %= CPU_CYCLES_PER_FRAME;
+            ++result.frames;
+
+            if (IsPlaying())
+            {
+                started = true;
+                result.load_end = result.frames;
+                result.load_end_state = 0;
+            }
+            else if (started && !result.load_end_state)
+            {
+                result.load_end_state = MachineState();
+            }
+
+            if (!(result.frames % check_frames))
+                result.states.push_back(MachineState());
+
+            // Without a frame count, stop once the tape has been idle for a while
+            if (frames == max_frames && started && result.frames - result.load_end >= idle_frames)
+                break;
+        }
+
+        result.passes = skipped_passes;
+        result.seconds = duration<double>(high_resolution_clock::now() - start_time).count();
+        return result;
+    };
+
+    auto report = std::string("Tape edge loop check: machine state with and without acceleration\n");
+    auto passed = true;
+
+    for (auto& tape_path : paths)
+    {
+        auto plain = run(tape_path, false, max_frames);
+        if (!plain.frames)
+        {
+            report += fmt::format("  {}: failed to load\n", fs::path(tape_path).filename().string());
+            passed = false;
+            continue;
+        }
+
+        auto fast = run(tape_path, true, plain.frames);
+
+        // Find the first second the states differ, if any
+        auto mismatch = std::mismatch(plain.states.begin(), plain.states.end(), fast.states.begin(), fast.states.end());
+        auto matched = mismatch.first == plain.states.end() && mismatch.second == fast.states.end() &&
+            plain.load_end == fast.load_end && plain.load_end_state == fast.load_end_state;
+
+        auto outcome = [&]() -> std::string
+        {
+            if (!plain.load_end)
+                return "tape not played";
+            else if (matched)
+                return fast.passes ? "matched" : "matched (not accelerated)";
+            else if (mismatch.first != plain.states.end())
+                return fmt::format("MISMATCH from {}s", (mismatch.first - plain.states.begin() + 1) * check_frames / EMULATED_FRAMES_PER_SECOND);
+
+            return fmt::format("MISMATCH at load end (frame {} vs {})", plain.load_end, fast.load_end);
+        };
+
+        report += fmt::format("  {}: {:.1f}s loading, {:.2f}s plain, {:.2f}s accelerated, {} passes skipped: {}\n",
+            fs::path(tape_path).filename().string(), static_cast<double>(plain.load_end) / EMULATED_FRAMES_PER_SECOND,
+            plain.seconds, fast.seconds, fast.passes, outcome());
+
+        passed &= matched && plain.load_end;
+    }
+
+    Eject();
+    Options::g_config = saved_options;
+
+    report += passed ? "All tapes matched" : "Differences found";
+    return report;
+}
+
 } // namespace Tape
@@ -30,6 +30,8 @@ std::string GetPath();
 std::string GetFile();
 libspectrum_tape* GetTape();
 std::string GetBlockDetails(libspectrum_tape_block* block);
+int CurrentBlock();
+void SelectBlock(int block_idx);
 
 bool Insert(const std::string& filepath);
 void Eject();
@@ -42,4 +44,7 @@ bool LoadTrap();
 void EiHook();
 bool RetZHook();
 void InFEHook();
+void EdgeLoopHook(uint16_t port, uint8_t val);
+
+std::string EdgeLoopCheck(const std::string& path);
 }
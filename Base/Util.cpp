@@ -146,6 +146,73 @@ uint16_t CrcBlock(const void* pcv_, size_t uLen_, uint16_t wCRC_/*=0xffff*/)
 }
 
 
+// 64-bit xxHash (XXH64) of a memory block
+uint64_t HashBlock(const void* pcv_, size_t uLen_, uint64_t seed_/*=0*/)
+{
+    constexpr uint64_t PRIME1 = 0x9e3779b185ebca87ULL;
+    constexpr uint64_t PRIME2 = 0xc2b2ae3d27d4eb4fULL;
+    constexpr uint64_t PRIME3 = 0x165667b19e3779f9ULL;
+    constexpr uint64_t PRIME4 = 0x85ebca77c2b2ae63ULL;
+    constexpr uint64_t PRIME5 = 0x27d4eb2f165667c5ULL;
+
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto round = [&](uint64_t acc, uint64_t input) { return rotl(acc + input * PRIME2, 31) * PRIME1; };
+    auto merge = [&](uint64_t acc, uint64_t val) { return (acc ^ round(0, val)) * PRIME1 + PRIME4; };
+#ifdef __BIG_ENDIAN__
+    auto read64 = [](const uint8_t* p) { uint64_t v; memcpy(&v, p, sizeof(v)); return byteswap(v); };
+    auto read32 = [](const uint8_t* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return byteswap(v); };
+#else
+    auto read64 = [](const uint8_t* p) { uint64_t v; memcpy(&v, p, sizeof(v)); return v; };
+    auto read32 = [](const uint8_t* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; };
+#endif
+
+    auto pb = reinterpret_cast<const uint8_t*>(pcv_);
+    auto pbEnd = pb + uLen_;
+    uint64_t h;
+
+    if (uLen_ >= 32)
+    {
+        uint64_t v1 = seed_ + PRIME1 + PRIME2, v2 = seed_ + PRIME2, v3 = seed_, v4 = seed_ - PRIME1;
+
+        for (; pb + 32 <= pbEnd; pb += 32)
+        {
+            v1 = round(v1, read64(pb));
+            v2 = round(v2, read64(pb + 8));
+            v3 = round(v3, read64(pb + 16));
+            v4 = round(v4, read64(pb + 24));
+        }
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    }
+    else
+    {
+        h = seed_ + PRIME5;
+    }
+
+    h += uLen_;
+
+    for (; pb + 8 <= pbEnd; pb += 8)
+        h = rotl(h ^ round(0, read64(pb)), 27) * PRIME1 + PRIME4;
+
+    if (pb + 4 <= pbEnd)
+    {
+        h = rotl(h ^ (read32(pb) * PRIME1), 23) * PRIME2 + PRIME3;
+        pb += 4;
+    }
+
+    while (pb < pbEnd)
+        h = rotl(h ^ (*pb++ * PRIME5), 11) * PRIME1;
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+
+    return h;
+}
+
 void PatchBlock(uint8_t* pb_, uint8_t* pbPatch_)
 {
     for (;;)
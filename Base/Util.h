@@ -42,6 +42,7 @@ void Message(MsgType type, const std::string& format, Args&& ... args)
 uint8_t GetSizeCode(unsigned int uSize_);
 std::string AbbreviateSize(uint64_t ullSize_);
 uint16_t CrcBlock(const void* pcv_, size_t uLen_, uint16_t wCRC_ = 0xffff);
+uint64_t HashBlock(const void* pcv_, size_t uLen_, uint64_t seed_ = 0);
 void PatchBlock(uint8_t* pb_, uint8_t* pbPatch_);
 unsigned int TPeek(const uint8_t* pb_);
 
@@ -102,6 +103,33 @@ private:
 struct FILECloser { void operator()(FILE* file) { fclose(file); } };
 using unique_FILE = unique_resource<FILE*, nullptr, FILECloser>;
 
+// Non-owning view of contiguous data, covering the subset of C++20 std::span we need
+template <typename T>
+class span
+{
+public:
+    constexpr span() = default;
+    constexpr span(T* data, size_t size) : m_data(data), m_size(size) {}
+
+    template <typename C, typename = std::enable_if_t<std::is_convertible_v<decltype(std::declval<C&>().data()), T*>>>
+    constexpr span(C& container) : m_data(container.data()), m_size(container.size()) {}
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+    constexpr span(const span<U>& other) : m_data(other.data()), m_size(other.size()) {}
+
+    constexpr T* data() const { return m_data; }
+    constexpr size_t size() const { return m_size; }
+    constexpr bool empty() const { return !m_size; }
+    constexpr T* begin() const { return m_data; }
+    constexpr T* end() const { return m_data + m_size; }
+    constexpr T& operator[](size_t index) const { return m_data[index]; }
+    constexpr span subspan(size_t offset, size_t count) const { return { m_data + offset, count }; }
+
+private:
+    T* m_data = nullptr;
+    size_t m_size = 0;
+};
+
 
 #ifdef _DEBUG
 void TraceOutputString(const std::string& str);
@@ -29,8 +29,8 @@
 
 constexpr uint16_t SP0256_ROM_ADDR = 0x1000;
 
-VoiceBoxDevice::VoiceBoxDevice() :
-    m_sp0256(SAMPLE_FREQ)
+VoiceBoxDevice::VoiceBoxDevice(const DAC& clock) :
+    SoundDevice(clock.SampleFreq()), m_clock(clock), m_sp0256(clock.SampleFreq())
 {
     auto rom_path = OSD::MakeFilePath(PathType::Resource, "sp0256-al2.bin");
     if (auto file = Stream::Open(rom_path.c_str()))
@@ -68,7 +68,7 @@ void VoiceBoxDevice::Update(bool frame_end)
     if (!GetOption(voicebox))
         return;
 
-    int samples_so_far = frame_end ? pDAC->GetSampleCount() : pDAC->GetSamplesSoFar();
+    int samples_so_far = frame_end ? m_clock.GetSampleCount() : m_clock.GetSamplesSoFar();
 
     int samples_needed = samples_so_far - m_samples_this_frame;
     if (samples_needed <= 0)
@@ -81,13 +81,11 @@ void VoiceBoxDevice::Update(bool frame_end)
     }
     else
     {
-        m_sp0256.sound_stream_update((stream_sample_t*)pb, samples_needed);
+        // The chip still runs while silent, as its timing is visible through the busy status
+        m_sp0256.sound_stream_update(reinterpret_cast<stream_sample_t*>(pb), samples_needed, SAMPLE_CHANNELS);
 
-        auto pw = reinterpret_cast<int16_t*>(pb);
-        for (int i = samples_needed - 1; i >= 0; --i)
-        {
-            pw[i * 2] = pw[i * 2 + 1] = pw[i];
-        }
+        if (m_silent)
+            memset(pb, 0x00, samples_needed * BYTES_PER_SAMPLE);
     }
 
     m_samples_this_frame = samples_so_far;
@@ -27,7 +27,7 @@
 class VoiceBoxDevice final : public SoundDevice
 {
 public:
-    VoiceBoxDevice();
+    explicit VoiceBoxDevice(const DAC& clock);
 
     void Reset() override;
     uint8_t In(uint16_t port) override;
@@ -37,6 +37,7 @@ public:
 protected:
     void Update(bool frame_end = false);
 
+    const DAC& m_clock;
     sp0256_device m_sp0256;
 };
 
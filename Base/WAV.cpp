@@ -28,10 +28,26 @@
 namespace WAV
 {
 
+constexpr size_t WRITE_BUFFER_SECONDS = 4;
+constexpr uint64_t MAX_RIFF_SIZE = 0xffffffff;
+
 static std::string wav_path;
 static unique_FILE file;
 static int nFrames, nSilent = 0;
 static bool fSegment;
+static uint64_t data_size;      // bytes successfully written, owned by the writer thread
+static int dropped_frames;
+
+// Frame data is staged in a ring buffer and written by a background thread. Runs of
+// silence are queued as lengths at a buffer position, rather than as buffered data.
+static std::vector<uint8_t> write_buffer;
+static size_t write_head, write_tail;
+static std::deque<std::pair<size_t, uint64_t>> silence_queue;
+static std::thread writer_thread;
+static std::mutex writer_mutex;
+static std::condition_variable writer_cv;
+static bool writer_exit;
+static std::atomic<bool> write_failed;
 
 
 // RIFF header must be byte-packed
@@ -39,12 +55,24 @@ static bool fSegment;
 
 struct tagRIFF
 {
-    uint8_t abRiffHeader[4];   // 'R','I','F','F'
+    uint8_t abRiffHeader[4];   // 'R','I','F','F' or 'R','F','6','4'
     uint8_t abWaveLen[4];
 
     struct
     {
-        uint8_t fmtheader[8];  // 'W','A','V','E','f','m','t',' '
+        uint8_t waveheader[4]; // 'W','A','V','E'
+
+        struct
+        {
+            uint8_t ds64header[4];     // 'J','U','N','K' placeholder, or 'd','s','6','4' for RF64
+            uint8_t ds64len[4];
+            uint8_t RiffSize[8];
+            uint8_t DataSize[8];
+            uint8_t SampleCount[8];
+            uint8_t TableLength[4];
+        } ds64;
+
+        uint8_t fmtheader[4];  // 'f','m','t',' '
         uint8_t fmtlen[4];
 
         struct
@@ -65,25 +93,164 @@ struct tagRIFF
             // PCM data starts here...
         } pcmdata;
     } wave;
-} riff =
-{
-    { 'R','I','F','F' }, { sizeof(riff.wave) },
-        {  { 'W','A','V','E','f','m','t',' ' }, { sizeof(riff.wave.fmt) },
-            { {1}, {0},{0},{0},{0},{0} } ,
-            { { 'd','a','t','a' }, {0,0,0,0} }
-    }
-};
+} riff;
 
 #pragma pack()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-static void WriteWaveValue(long lVal_, uint8_t* pb_, int nSize_)
+static void WriteWaveValue(uint64_t lVal_, uint8_t* pb_, int nSize_)
 {
     for (int i = 0; i < nSize_; i++)
         *pb_++ = static_cast<uint8_t>((lVal_ >> (i << 3)) & 0xff);
 }
 
+static void InitHeader()
+{
+    riff = {};
+    memcpy(riff.abRiffHeader, "RIFF", sizeof(riff.abRiffHeader));
+    memcpy(riff.wave.waveheader, "WAVE", sizeof(riff.wave.waveheader));
+    memcpy(riff.wave.ds64.ds64header, "JUNK", sizeof(riff.wave.ds64.ds64header));
+    memcpy(riff.wave.fmtheader, "fmt ", sizeof(riff.wave.fmtheader));
+    memcpy(riff.wave.pcmdata.dataheader, "data", sizeof(riff.wave.pcmdata.dataheader));
+
+    WriteWaveValue(sizeof(riff.wave), riff.abWaveLen, sizeof(riff.abWaveLen));
+    WriteWaveValue(sizeof(riff.wave.ds64) - 8, riff.wave.ds64.ds64len, sizeof(riff.wave.ds64.ds64len));
+    WriteWaveValue(sizeof(riff.wave.fmt), riff.wave.fmtlen, sizeof(riff.wave.fmtlen));
+
+    WriteWaveValue(1, riff.wave.fmt.FormatTag, sizeof(riff.wave.fmt.FormatTag));
+    WriteWaveValue(SAMPLE_CHANNELS, riff.wave.fmt.Channels, sizeof(riff.wave.fmt.Channels));
+    WriteWaveValue(Sound::SampleFreq(), riff.wave.fmt.SamplesPerSec, sizeof(riff.wave.fmt.SamplesPerSec));
+    WriteWaveValue(Sound::SampleFreq() * BYTES_PER_SAMPLE, riff.wave.fmt.AvgBytesPerSec, sizeof(riff.wave.fmt.AvgBytesPerSec));
+    WriteWaveValue(BYTES_PER_SAMPLE, riff.wave.fmt.BlockAlign, sizeof(riff.wave.fmt.BlockAlign));
+    WriteWaveValue(SAMPLE_BITS, riff.wave.fmt.BitsPerSample, sizeof(riff.wave.fmt.BitsPerSample));
+}
+
+static void UpdateHeaderSizes()
+{
+    // Recordings beyond the 32-bit RIFF limit switch to RF64, with the real sizes in the ds64 chunk
+    uint64_t riff_size = sizeof(riff.wave) + data_size;
+    if (riff_size > MAX_RIFF_SIZE)
+    {
+        memcpy(riff.abRiffHeader, "RF64", sizeof(riff.abRiffHeader));
+        memcpy(riff.wave.ds64.ds64header, "ds64", sizeof(riff.wave.ds64.ds64header));
+
+        WriteWaveValue(riff_size, riff.wave.ds64.RiffSize, sizeof(riff.wave.ds64.RiffSize));
+        WriteWaveValue(data_size, riff.wave.ds64.DataSize, sizeof(riff.wave.ds64.DataSize));
+        WriteWaveValue(data_size / BYTES_PER_SAMPLE, riff.wave.ds64.SampleCount, sizeof(riff.wave.ds64.SampleCount));
+
+        WriteWaveValue(MAX_RIFF_SIZE, riff.wave.pcmdata.datalen, sizeof(riff.wave.pcmdata.datalen));
+        WriteWaveValue(MAX_RIFF_SIZE, riff.abWaveLen, sizeof(riff.abWaveLen));
+    }
+    else
+    {
+        WriteWaveValue(data_size, riff.wave.pcmdata.datalen, sizeof(riff.wave.pcmdata.datalen));
+        WriteWaveValue(riff_size, riff.abWaveLen, sizeof(riff.abWaveLen));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void WriterThread()
+{
+    static const std::array<uint8_t, 0x10000> zeros{};
+
+    auto write = [](const uint8_t* pb, size_t len)
+    {
+        if (!write_failed && fwrite(pb, 1, len, file) != len)
+            write_failed = true;
+
+        if (!write_failed)
+            data_size += len;
+    };
+
+    for (;;)
+    {
+        size_t head, tail;
+        std::optional<std::pair<size_t, uint64_t>> silence;
+        {
+            std::unique_lock<std::mutex> lock(writer_mutex);
+            writer_cv.wait(lock, [] { return writer_exit || write_head != write_tail || !silence_queue.empty(); });
+
+            head = write_head;
+            tail = write_tail;
+            if (!silence_queue.empty())
+                silence = silence_queue.front();
+            else if (head == tail)
+                break;
+        }
+
+        // Write data up to any silence, in up to two pieces if it wraps the end of the buffer
+        auto limit = silence ? silence->first : head;
+        while (tail != limit)
+        {
+            auto offset = tail % write_buffer.size();
+            auto len = std::min(limit - tail, write_buffer.size() - offset);
+
+            write(write_buffer.data() + offset, len);
+            tail += len;
+        }
+
+        if (silence)
+        {
+            for (auto len = silence->second; len > 0; )
+            {
+                auto chunk = static_cast<size_t>(std::min<uint64_t>(len, zeros.size()));
+                write(zeros.data(), chunk);
+                len -= chunk;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            write_tail = tail;
+            if (silence)
+                silence_queue.pop_front();
+        }
+        writer_cv.notify_all();
+    }
+}
+
+// Queue frame data for writing, dropping it if the writer has fallen too far behind
+static void QueueData(const uint8_t* pb_, size_t len)
+{
+    size_t head;
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        head = write_head;
+        if (write_buffer.size() - (head - write_tail) < len)
+        {
+            ++dropped_frames;
+            return;
+        }
+    }
+
+    // Copy in up to two pieces, if it wraps the end of the buffer
+    for (size_t done = 0; done < len; )
+    {
+        auto offset = (head + done) % write_buffer.size();
+        auto chunk = std::min(len - done, write_buffer.size() - offset);
+        memcpy(write_buffer.data() + offset, pb_ + done, chunk);
+        done += chunk;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        write_head += len;
+    }
+    writer_cv.notify_all();
+}
+
+// Queue a run of silence, which the writer generates without using the buffer
+static void QueueSilence(uint64_t len)
+{
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        silence_queue.emplace_back(write_head, len);
+    }
+    writer_cv.notify_all();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 bool Start(bool fSegment_)
@@ -100,18 +267,23 @@ bool Start(bool fSegment_)
         return false;
     }
 
-    // Write the RIFF header
-    WriteWaveValue(SAMPLE_CHANNELS, riff.wave.fmt.Channels, sizeof(riff.wave.fmt.Channels));
-    WriteWaveValue(SAMPLE_FREQ, riff.wave.fmt.SamplesPerSec, sizeof(riff.wave.fmt.SamplesPerSec));
-    WriteWaveValue(SAMPLE_FREQ * BYTES_PER_SAMPLE, riff.wave.fmt.AvgBytesPerSec, sizeof(riff.wave.fmt.AvgBytesPerSec));
-    WriteWaveValue(BYTES_PER_SAMPLE, riff.wave.fmt.BlockAlign, sizeof(riff.wave.fmt.BlockAlign));
-    WriteWaveValue(SAMPLE_BITS, riff.wave.fmt.BitsPerSample, sizeof(riff.wave.fmt.BitsPerSample));
+    // Write the initial RIFF header, with space reserved for RF64 sizes
+    InitHeader();
     fwrite(&riff, sizeof(riff), 1, file);
 
     // Reset the frame counters and store the fragment flag
     nFrames = nSilent = 0;
+    data_size = 0;
+    dropped_frames = 0;
     fSegment = fSegment_;
 
+    write_buffer.resize(Sound::SampleFreq() * BYTES_PER_SAMPLE * WRITE_BUFFER_SECONDS);
+    write_head = write_tail = 0;
+    silence_queue.clear();
+    writer_exit = false;
+    write_failed = false;
+    writer_thread = std::thread(WriterThread);
+
     Frame::SetStatus("Recording WAV{}", fSegment_ ? " segment" : "");
     return true;
 }
@@ -122,12 +294,26 @@ void Stop()
     if (!file)
         return;
 
-    // Update the data length in the header
-    long lDataSize = ftell(file) - sizeof(riff);
-    WriteWaveValue(lDataSize, riff.wave.pcmdata.datalen, sizeof(int32_t));
-    WriteWaveValue(lDataSize + sizeof(riff.wave), riff.abWaveLen, sizeof(int32_t));
+    // Flush any buffered data and wait for the writer to finish
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        writer_exit = true;
+    }
+    writer_cv.notify_all();
+
+    if (writer_thread.joinable())
+        writer_thread.join();
+
+    write_buffer.clear();
+    write_buffer.shrink_to_fit();
+
+    if (write_failed)
+        TRACE("!!! WAV::Stop(): Failed to write sample data\n");
+    if (dropped_frames)
+        TRACE("!!! WAV::Stop(): Dropped {} frames, as writing fell behind\n", dropped_frames);
 
     // Rewrite the completed file header
+    UpdateHeaderSizes();
     if (fseek(file, 0, SEEK_SET) == 0)
     {
         if (fwrite(&riff, 1, sizeof(riff), file) != sizeof(riff))
@@ -136,7 +322,11 @@ void Stop()
 
     file.reset();
 
-    if (nFrames)
+    if (nFrames && dropped_frames)
+    {
+        Frame::SetStatus("Saved {} ({} frames dropped)", wav_path, dropped_frames);
+    }
+    else if (nFrames)
     {
         Frame::SetStatus("Saved {}", wav_path);
     }
@@ -168,6 +358,13 @@ void AddFrame(const uint8_t* pb_, int nLen_)
     if (!file)
         return;
 
+    // Stop if the background writer has hit an error
+    if (write_failed)
+    {
+        Stop();
+        return;
+    }
+
     // Check for a full frame of repeated samples (silence)
     if (!memcmp(pb_, pb_ + BYTES_PER_SAMPLE, nLen_ - BYTES_PER_SAMPLE))
     {
@@ -183,17 +380,18 @@ void AddFrame(const uint8_t* pb_, int nLen_)
         if (nSilent)
         {
             // Add the accumulated silence, unless we're at the start of the recording
-            if (nFrames && fseek(file, nLen_ * nSilent, SEEK_CUR) == 0)
+            if (nFrames)
+            {
+                QueueSilence(static_cast<uint64_t>(nLen_) * nSilent);
                 nFrames += nSilent;
+            }
 
             nSilent = 0;
         }
 
-        // Write the new frame data
-        if (fwrite(pb_, nLen_, 1, file))
-            nFrames++;
-        else
-            Stop();
+        // Queue the new frame data for the writer thread, without ever waiting for it
+        QueueData(pb_, nLen_);
+        nFrames++;
     }
 }
 
@@ -113,6 +113,20 @@ inline int sp0256_device::lpc12_t::update(int num_samp, int16_t *out, uint32_t *
     int i;
     int oidx = *optr;
 
+    /* -------------------------------------------------------------------- */
+    /*  Work on local copies of the widened coefficients and filter state,  */
+    /*  which the compiler can keep in registers for the whole loop.        */
+    /* -------------------------------------------------------------------- */
+    int b[6], f[6];
+    int16_t z0[6], z1[6];
+    for (int j = 0; j < 6; j++)
+    {
+        b[j] = b_coef[j];
+        f[j] = f_coef[j];
+        z0[j] = z_data[j][0];
+        z1[j] = z_data[j][1];
+    }
+
     /* -------------------------------------------------------------------- */
     /*  Iterate up to the desired number of samples.  We actually may       */
     /*  break out early if our repeat count expires.                        */
@@ -134,7 +148,7 @@ inline int sp0256_device::lpc12_t::update(int num_samp, int16_t *out, uint32_t *
                 do_int = interp;
 
                 for (int j = 0; j < 6; j++)
-                    z_data[j][1] = z_data[j][0] = 0;
+                    z1[j] = z0[j] = 0;
             }
             else
             {
@@ -150,7 +164,7 @@ inline int sp0256_device::lpc12_t::update(int num_samp, int16_t *out, uint32_t *
                 cnt = PER_NOISE;
                 rpt--;
                 for (int j = 0; j < 6; j++)
-                    z_data[j][0] = z_data[j][1] = 0;
+                    z0[j] = z1[j] = 0;
             }
 
             const bool bit(rng & 1);
@@ -208,11 +222,11 @@ inline int sp0256_device::lpc12_t::update(int num_samp, int16_t *out, uint32_t *
         /* ---------------------------------------------------------------- */
         for (int j = 0; j < 6; j++)
         {
-            samp += (int(b_coef[j]) * int(z_data[j][1])) >> 9;
-            samp += (int(f_coef[j]) * int(z_data[j][0])) >> 8;
+            samp += (b[j] * z1[j]) >> 9;
+            samp += (f[j] * z0[j]) >> 8;
 
-            z_data[j][1] = z_data[j][0];
-            z_data[j][0] = samp;
+            z1[j] = z0[j];
+            z0[j] = samp;
         }
 
 #ifdef HIGH_QUALITY /* Higher quality than the original, but who cares? */
@@ -222,6 +236,12 @@ inline int sp0256_device::lpc12_t::update(int num_samp, int16_t *out, uint32_t *
 #endif
     }
 
+    for (int j = 0; j < 6; j++)
+    {
+        z_data[j][0] = z0[j];
+        z_data[j][1] = z1[j];
+    }
+
     *optr = oidx;
 
     return i;
@@ -1129,7 +1149,26 @@ void sp0256_device::spb640_w(uint16_t offset, uint16_t data)
 //  sound_stream_update - handle a stream update
 //-------------------------------------------------
 
-void sp0256_device::sound_stream_update(stream_sample_t* output, int samples)
+bool sp0256_device::is_idle() const
+{
+    /* -------------------------------------------------------------------- */
+    /*  Halted with no command pending, and the filter and resampling       */
+    /*  window settled at zero, so the output will be silence until the     */
+    /*  next command arrives.                                               */
+    /* -------------------------------------------------------------------- */
+    if (!m_halted || !m_lrq || m_filt.amp || m_sc_head != m_sc_tail)
+        return false;
+
+    for (int j = 0; j < 6; j++)
+    {
+        if (m_filt.z_data[j][0] || m_filt.z_data[j][1])
+            return false;
+    }
+
+    return std::all_of(m_window.begin(), m_window.end(), [](int16_t s) { return s == 0; });
+}
+
+void sp0256_device::sound_stream_update(stream_sample_t* output, int samples, int channels)
 {
     constexpr bool pal_mode = true;
     constexpr auto sys_clock = pal_mode ? 4'000'000 : 3'579'545;
@@ -1138,6 +1177,15 @@ void sp0256_device::sound_stream_update(stream_sample_t* output, int samples)
     int output_index = 0;
     int length, did_samp;
 
+    /* -------------------------------------------------------------------- */
+    /*  Fast path for an idle chip, which just outputs silence.             */
+    /* -------------------------------------------------------------------- */
+    if (is_idle())
+    {
+        std::fill(output, output + samples * channels, 0);
+        return;
+    }
+
     while (output_index < samples)
     {
         /* ---------------------------------------------------------------- */
@@ -1173,7 +1221,11 @@ void sp0256_device::sound_stream_update(stream_sample_t* output, int samples)
                     ws = m_wind_sum / static_cast<int32_t>(m_window.size());
                 }
 
-                output[output_index++] = ws;
+                /* Write directly to each channel of interleaved output */
+                for (int c = 0; c < channels; c++)
+                    output[output_index * channels + c] = ws;
+
+                output_index++;
 
                 if (output_index >= samples)
                     return;
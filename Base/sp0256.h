@@ -46,7 +46,7 @@ public:
 
     void reset();
 
-    void sound_stream_update(stream_sample_t *output, int samples);
+    void sound_stream_update(stream_sample_t *output, int samples, int channels = 1);
 
 private:
     struct lpc12_t
@@ -69,6 +69,7 @@ private:
 
     uint32_t getb(int len);
     void micro();
+    bool is_idle() const;
 
     std::array<uint8_t, 0x10000> m_rom{}; // 64K ROM.
 
@@ -18,6 +18,16 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
+// Notes:
+//  Sound data is passed to the SDL audio callback through a single-producer
+//  single-consumer ring buffer. The emulation thread writes at the head and
+//  the callback reads from the tail, with only atomic position updates between
+//  them. When the buffer is above the latency target the emulation thread waits
+//  until the time the callback should have drained the excess, or until woken
+//  early by the callback. Underruns are filled with silence, and only counted
+//  while the emulation is producing data, so turbo, pause and the GUI don't
+//  inflate the count.
+
 #include "SimCoupe.h"
 
 #include "Audio.h"
@@ -25,20 +35,44 @@
 #include "Sound.h"
 
 constexpr auto MIN_LATENCY_FRAMES = 4;
+constexpr auto MAX_LATENCY_FRAMES = 20;
 
 static SDL_AudioDeviceID dev;
 
+static std::vector<uint8_t> ring;           // power-of-2 sized ring buffer
+static std::atomic<size_t> ring_head;       // total bytes written (emulation thread)
+static std::atomic<size_t> ring_tail;       // total bytes read (audio callback)
+static std::atomic<bool> waiting;
+static std::atomic<uint32_t> underruns;
+static std::atomic<uint32_t> overruns;
+static std::atomic<int64_t> last_add_us;    // time of the last AddData call
+
+static std::mutex wait_mutex;
+static std::condition_variable wait_cv;
+
+static void AudioCallback(void* userdata, Uint8* stream, int len);
+
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Audio::Init()
 {
     Exit();
 
+    // Size the ring to hold the maximum latency, with room to spare
+    size_t ring_size = 1;
+    while (ring_size < static_cast<size_t>(Sound::SamplesPerFrame()) * (MAX_LATENCY_FRAMES + 2) * BYTES_PER_SAMPLE)
+        ring_size <<= 1;
+
+    ring.assign(ring_size, 0);
+    ring_head = ring_tail = 0;
+    last_add_us = 0;
+
     SDL_AudioSpec desired{};
-    desired.freq = SAMPLE_FREQ;
+    desired.freq = Sound::SampleFreq();
     desired.format = AUDIO_S16LSB;
     desired.channels = SAMPLE_CHANNELS;
     desired.samples = 512;
+    desired.callback = AudioCallback;
 
     dev = SDL_OpenAudioDevice(nullptr, 0, &desired, nullptr, 0);
     if (!dev)
@@ -58,21 +92,96 @@ void Audio::Exit()
         SDL_CloseAudioDevice(dev);
         dev = 0;
     }
+
+    ring.clear();
+}
+
+static int64_t NowMicroseconds()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
 }
 
 float Audio::AddData(uint8_t* pData_, int len_bytes)
 {
-    SDL_QueueAudio(dev, pData_, len_bytes);
+    if (!dev)
+        return 0.0f;
 
-    auto buffer_frames = std::max(GetOption(latency), MIN_LATENCY_FRAMES);
-    Uint32 buffer_size = SAMPLES_PER_FRAME * buffer_frames * BYTES_PER_SAMPLE;
+    last_add_us = NowMicroseconds();
 
-#if 1
-    while (SDL_GetQueuedAudioSize(dev) >= buffer_size)
+    auto buffer_frames = std::clamp(GetOption(latency), MIN_LATENCY_FRAMES, MAX_LATENCY_FRAMES);
+    size_t buffer_size = Sound::SamplesPerFrame() * buffer_frames * BYTES_PER_SAMPLE;
+
+    // Wait for the callback to drain the buffer below the latency target
+    auto fill = ring_head.load() - ring_tail.load(std::memory_order_acquire);
+    if (fill >= buffer_size)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        using namespace std::chrono;
+        auto excess = fill - buffer_size + BYTES_PER_SAMPLE;
+        auto deadline = steady_clock::now() + microseconds(excess * 1'000'000 / (Sound::SampleFreq() * BYTES_PER_SAMPLE));
+
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        waiting = true;
+        wait_cv.wait_until(lock, deadline, [&] {
+            return ring_head.load() - ring_tail.load(std::memory_order_acquire) < buffer_size; });
+        waiting = false;
+    }
+
+    // Copy as much as fits, in up to two parts if it wraps
+    auto head = ring_head.load();
+    auto space = ring.size() - (head - ring_tail.load(std::memory_order_acquire));
+    auto len = std::min(static_cast<size_t>(len_bytes), space);
+    if (len < static_cast<size_t>(len_bytes))
+        overruns++;
+
+    auto offset = head & (ring.size() - 1);
+    auto first = std::min(len, ring.size() - offset);
+
+    memcpy(ring.data() + offset, pData_, first);
+    memcpy(ring.data(), pData_ + first, len - first);
+    ring_head.store(head + len, std::memory_order_release);
+
+    fill = ring_head.load() - ring_tail.load(std::memory_order_acquire);
+    return static_cast<float>(fill) / buffer_size;
+}
+
+uint32_t Audio::Underruns()
+{
+    return underruns;
+}
+
+uint32_t Audio::Overruns()
+{
+    return overruns;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void AudioCallback(void* /*userdata*/, Uint8* stream, int len)
+{
+    auto tail = ring_tail.load();
+    auto avail = ring_head.load(std::memory_order_acquire) - tail;
+    auto copy = std::min(static_cast<size_t>(len), avail);
+    auto offset = tail & (ring.size() - 1);
+    auto first = std::min(copy, ring.size() - offset);
+
+    memcpy(stream, ring.data() + offset, first);
+    memcpy(stream + first, ring.data(), copy - first);
+    ring_tail.store(tail + copy, std::memory_order_release);
+
+    // Pad any underrun with silence, only counting it if data was added within
+    // the last frame and callback period, so the emulation is still producing
+    if (copy < static_cast<size_t>(len))
+    {
+        memset(stream + copy, 0, len - copy);
+
+        auto period_us = static_cast<int64_t>(Sound::SamplesPerFrame() * BYTES_PER_SAMPLE + len) *
+            1'000'000 / (Sound::SampleFreq() * BYTES_PER_SAMPLE);
+        auto last_add = last_add_us.load();
+        if (last_add && NowMicroseconds() - last_add <= period_us)
+            underruns++;
     }
-#endif
 
-    return static_cast<float>(SDL_GetQueuedAudioSize(dev)) / buffer_size;
+    if (waiting)
+        wait_cv.notify_one();
 }
@@ -26,4 +26,7 @@ public:
     static bool Init();
     static void Exit();
     static float AddData(uint8_t* pData, int len_bytes);
+
+    static uint32_t Underruns();
+    static uint32_t Overruns();
 };
@@ -45,6 +45,9 @@ static HANDLE hEvent;
 static MMRESULT hTimer;
 static DWORD dwTimerPeriod;
 
+static uint32_t underruns;
+static bool submitted;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 bool Audio::Init()
@@ -85,15 +88,15 @@ bool Audio::Init()
 #endif
 
     if (SUCCEEDED(hr))
-        hr = pXAudio2->CreateMasteringVoice(&pMasteringVoice, 2, SAMPLE_FREQ);
+        hr = pXAudio2->CreateMasteringVoice(&pMasteringVoice, 2, Sound::SampleFreq());
 
     WAVEFORMATEX wfx{};
     wfx.wFormatTag = WAVE_FORMAT_PCM;
-    wfx.nSamplesPerSec = SAMPLE_FREQ;
+    wfx.nSamplesPerSec = Sound::SampleFreq();
     wfx.wBitsPerSample = SAMPLE_BITS;
     wfx.nChannels = SAMPLE_CHANNELS;
     wfx.nBlockAlign = BYTES_PER_SAMPLE;
-    wfx.nAvgBytesPerSec = SAMPLE_FREQ * BYTES_PER_SAMPLE;
+    wfx.nAvgBytesPerSec = Sound::SampleFreq() * BYTES_PER_SAMPLE;
 
     if (SUCCEEDED(hr))
         hr = pXAudio2->CreateSourceVoice(&pSourceVoice, &wfx);
@@ -166,7 +169,7 @@ float Audio::AddData(uint8_t* pData, int len_bytes)
     data.insert(data.end(), pData, pData + len_bytes);
 
     auto buffer_frames = std::max(GetOption(latency), MIN_LATENCY_FRAMES);
-    size_t buffer_size = SAMPLES_PER_FRAME * buffer_frames / SOUND_BUFFERS * BYTES_PER_SAMPLE;
+    size_t buffer_size = Sound::SamplesPerFrame() * buffer_frames / SOUND_BUFFERS * BYTES_PER_SAMPLE;
     while (data.size() >= buffer_size)
     {
         for (;;)
@@ -177,7 +180,12 @@ float Audio::AddData(uint8_t* pData, int len_bytes)
             pSourceVoice->GetState(&state);
 #endif
             if (state.BuffersQueued < SOUND_BUFFERS)
+            {
+                // The voice has starved if everything we submitted has been played
+                if (!state.BuffersQueued && submitted)
+                    underruns++;
                 break;
+            }
 
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
@@ -193,9 +201,21 @@ float Audio::AddData(uint8_t* pData, int len_bytes)
         buffer.pAudioData = current_buffer.data();
         buffer.AudioBytes = static_cast<UINT32>(current_buffer.size());
         pSourceVoice->SubmitSourceBuffer(&buffer);
+        submitted = true;
 
         buffer_index = (buffer_index + 1) % SOUND_BUFFERS;
     }
 
     return static_cast<float>(state.BuffersQueued) / SOUND_BUFFERS;
 }
+
+uint32_t Audio::Underruns()
+{
+    return underruns;
+}
+
+uint32_t Audio::Overruns()
+{
+    // Data is never dropped, as AddData blocks until there's space
+    return 0;
+}
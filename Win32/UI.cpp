@@ -553,10 +553,10 @@ void UpdateTapeBlockList(HWND hdlg_)
         ListView_SetItemText(hwndList, nIndex, 1, const_cast<char*>(details.c_str()));
     }
 
-    // Fetch the current block index
-    if (block_idx > 0 && libspectrum_tape_position(&block_idx, tape) == LIBSPECTRUM_ERROR_NONE)
+    // Select the current block in the list, and ensure it's visible
+    if (block_idx > 0)
     {
-        // Select the current block in the list, and ensure it's visible
+        block_idx = Tape::CurrentBlock();
         ListView_SetItemState(hwndList, block_idx, LVIS_SELECTED | LVIS_FOCUSED, LVIS_SELECTED | LVIS_FOCUSED);
         ListView_EnsureVisible(hwndList, block_idx, FALSE);
     }
@@ -653,11 +653,10 @@ INT_PTR CALLBACK TapeBrowseDlgProc(HWND hdlg_, UINT uMsg_, WPARAM wParam_, LPARA
         if (wParam_ == IDL_TAPE_BLOCKS && pnmh->code == NM_CLICK)
         {
             LPNMITEMACTIVATE pnmia = reinterpret_cast<LPNMITEMACTIVATE>(lParam_);
-            libspectrum_tape* tape = Tape::GetTape();
 
             // Select the tape block corresponding to the row clicked
-            if (tape && pnmia->iItem >= 0)
-                libspectrum_tape_nth_block(tape, pnmia->iItem);
+            if (pnmia->iItem >= 0)
+                Tape::SelectBlock(pnmia->iItem);
         }
         // Tooltip display request?
         else if (pnmh->code == TTN_GETDISPINFO)